@@ -0,0 +1,431 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Alert rules.
+ *
+ * Rules are checked where the data shows up: log rules on the capture path,
+ * for every record, and threshold rules on the sampling tick. A rule that
+ * matches switches the dashboard on, on the rule's page, with the record that
+ * triggered it pinned and highlighted on the logs page.
+ *
+ * The capture path must stay cheap. Match patterns are compiled once, when
+ * the rule set is written, and a message costs one pass per log rule that is
+ * not cooling down; with no log rules it is a single load. A rule that fires
+ * stays quiet for alert_cooldown_ms, and it is not even evaluated meanwhile,
+ * so a flood of matching records costs no more than a flood of others. On
+ * top of that only one alert is in flight: alerts raised before the
+ * dashboard has surfaced the previous one are counted and dropped, so a
+ * burst of rules firing together is a single render.
+ *
+ * Raising an alert only fills the pending slot and queues an irq_work; the
+ * capture path may run under console and printk locks and cannot take the
+ * render lock or queue work directly. The work item then goes through the
+ * same entry points as the debugfs files.
+ */
+#include <linux/kernel.h>
+#include <linux/atomic.h>
+#include <linux/err.h>
+#include <linux/irq_work.h>
+#include <linux/jiffies.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/rcupdate.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/textsearch.h>
+#include <linux/workqueue.h>
+
+#include "vgadash.h"
+#include "alerts.h"
+#include "heartbeat.h"
+#include "sampler.h"
+
+#define ALERT_DESC_LEN 96
+#define ALERT_NO_SEQ   U64_MAX
+
+static unsigned int alert_cooldown_ms = 10000;
+module_param(alert_cooldown_ms, uint, 0644);
+MODULE_PARM_DESC(alert_cooldown_ms, "Quiet time of an alert rule after it fires, in ms");
+
+enum alert_kind {
+	ALERT_MATCH,
+	ALERT_LEVEL,
+	ALERT_MEMFREE,
+	ALERT_STALL,
+	ALERT_NR_KINDS,
+};
+
+static const char * const alert_kinds[ALERT_NR_KINDS] = {
+	[ALERT_MATCH]   = "match",
+	[ALERT_LEVEL]   = "level",
+	[ALERT_MEMFREE] = "memfree",
+	[ALERT_STALL]   = "stall",
+};
+
+static const enum vgadash_page alert_default_page[ALERT_NR_KINDS] = {
+	[ALERT_MATCH]   = VGADASH_PAGE_LOGS,
+	[ALERT_LEVEL]   = VGADASH_PAGE_LOGS,
+	[ALERT_MEMFREE] = VGADASH_PAGE_STATE,
+	[ALERT_STALL]   = VGADASH_PAGE_STALL,
+};
+
+struct alert_rule {
+	enum alert_kind kind;
+	enum vgadash_page page;
+	u32 arg;                /* level, MiB or ms */
+	struct ts_config *ts;   /* ALERT_MATCH, compiled when the set is written */
+	unsigned long next;     /* jiffies until which the rule is quiet */
+	bool tripped;           /* threshold rules: condition held at the last tick */
+	atomic_t fired;
+	char desc[ALERT_DESC_LEN];
+};
+
+struct alert_set {
+	int n;
+	bool on_log;    /* has match or level rules */
+	bool on_stall;  /* has stall rules; keeps the heartbeats running */
+	struct alert_rule rules[ALERT_MAX_RULES];
+};
+
+/* Writers and the sampling tick hold alert_mutex; the capture path uses RCU */
+static DEFINE_MUTEX(alert_mutex);
+static struct alert_set __rcu *alert_rules;
+static bool alert_on_log;
+
+struct alert_event {
+	enum vgadash_page page;
+	u64 seq;        /* record to pin, or ALERT_NO_SEQ */
+	u64 value;      /* MiB or ms for threshold rules */
+	unsigned long when;
+	char desc[ALERT_DESC_LEN];
+};
+
+/* The one alert in flight, and the last one shown */
+static DEFINE_RAW_SPINLOCK(alert_lock);
+static bool alert_busy;
+static struct alert_event alert_ev;
+static struct alert_event alert_last;
+static bool alert_have_last;
+static u64 alert_raised;
+static u64 alert_suppressed;
+
+static void alert_work_fn(struct work_struct *work);
+static DECLARE_WORK(alert_work, alert_work_fn);
+
+static void alert_irq_work_fn(struct irq_work *w)
+{
+	schedule_work(&alert_work);
+}
+
+static DEFINE_IRQ_WORK(alert_irq_work, alert_irq_work_fn);
+
+static void alert_work_fn(struct work_struct *work)
+{
+	struct alert_event ev;
+
+	raw_spin_lock_irq(&alert_lock);
+	ev = alert_ev;
+	raw_spin_unlock_irq(&alert_lock);
+
+	/* Pin before the page switch so the first frame already shows it */
+	if (ev.seq != ALERT_NO_SEQ && ev.page == VGADASH_PAGE_LOGS)
+		vgadash_pin_log(ev.seq);
+	vgadash_set_page(ev.page);
+	vgadash_activate();
+
+	/* Only now take the next one: the flood waited for the render above */
+	raw_spin_lock_irq(&alert_lock);
+	alert_last = ev;
+	alert_have_last = true;
+	alert_busy = false;
+	raw_spin_unlock_irq(&alert_lock);
+}
+
+/* Returns false while the rule is cooling down */
+static bool alert_fire(struct alert_rule *r, u64 seq, u64 value)
+{
+	unsigned long now = jiffies, next = READ_ONCE(r->next);
+	unsigned long flags;
+	bool queue = false;
+
+	if (time_before(now, next))
+		return false;
+	/* Several CPUs may match at once; one of them wins the slot */
+	if (cmpxchg(&r->next, next, now + msecs_to_jiffies(alert_cooldown_ms)) != next)
+		return false;
+	atomic_inc(&r->fired);
+
+	raw_spin_lock_irqsave(&alert_lock, flags);
+	alert_raised++;
+	if (alert_busy) {
+		alert_suppressed++;
+	} else {
+		alert_busy = true;
+		alert_ev.page = r->page;
+		alert_ev.seq = seq;
+		alert_ev.value = value;
+		alert_ev.when = now;
+		strscpy(alert_ev.desc, r->desc, sizeof(alert_ev.desc));
+		queue = true;
+	}
+	raw_spin_unlock_irqrestore(&alert_lock, flags);
+
+	if (queue)
+		irq_work_queue(&alert_irq_work);
+	return true;
+}
+
+static bool rule_matches(struct alert_rule *r, const char *text, unsigned int len)
+{
+	struct ts_state state;
+
+	return textsearch_find_continuous(r->ts, &state, text, len) != UINT_MAX;
+}
+
+void vgadash_alert_log(u64 seq, u8 level, const char *text, unsigned int len)
+{
+	struct alert_set *set;
+	unsigned long now = jiffies;
+	int i;
+
+	if (!READ_ONCE(alert_on_log))
+		return;
+
+	rcu_read_lock();
+	set = rcu_dereference(alert_rules);
+	for (i = 0; set && i < set->n; i++) {
+		struct alert_rule *r = &set->rules[i];
+		bool hit;
+
+		/* Cooling down: not even looked at */
+		if (time_before(now, READ_ONCE(r->next)))
+			continue;
+
+		switch (r->kind) {
+		case ALERT_MATCH:
+			hit = rule_matches(r, text, len);
+			break;
+		case ALERT_LEVEL:
+			hit = level <= r->arg;
+			break;
+		default:
+			continue;
+		}
+		if (hit)
+			alert_fire(r, seq, 0);
+	}
+	rcu_read_unlock();
+}
+
+void vgadash_alert_tick(void)
+{
+	struct sampler_snap snap;
+	struct alert_set *set;
+	u64 stall_ns = 0;
+	int i;
+
+	mutex_lock(&alert_mutex);
+	set = rcu_dereference_protected(alert_rules, lockdep_is_held(&alert_mutex));
+	if (!set)
+		goto out;
+
+	vgadash_sampler_latest(&snap);
+	if (set->on_stall)
+		vgadash_hb_worst(&stall_ns);
+
+	/* Fire on the edge; a condition that holds on does not re-fire */
+	for (i = 0; i < set->n; i++) {
+		struct alert_rule *r = &set->rules[i];
+		u64 value;
+		bool cond;
+
+		switch (r->kind) {
+		case ALERT_MEMFREE:
+			value = snap.mem_free_mib;
+			cond = snap.seq && value < r->arg;
+			break;
+		case ALERT_STALL:
+			value = div_u64(stall_ns, NSEC_PER_MSEC);
+			cond = value >= r->arg;
+			break;
+		default:
+			continue;
+		}
+
+		if (!cond)
+			r->tripped = false;
+		else if (!r->tripped)
+			r->tripped = alert_fire(r, ALERT_NO_SEQ, value);
+	}
+out:
+	mutex_unlock(&alert_mutex);
+}
+
+static int parse_rule(char *s, struct alert_rule *r)
+{
+	char *kind = strsep(&s, " \t");
+	char *arg = s ? strim(s) : NULL;
+	char *at = strchr(kind, '@');
+	int k, p = -1, ret;
+
+	if (at) {
+		*at++ = '\0';
+		p = vgadash_page_by_name(at);
+		if (p < 0)
+			return p;
+	}
+
+	k = match_string(alert_kinds, ALERT_NR_KINDS, kind);
+	if (k < 0)
+		return k;
+	if (!arg || !*arg)
+		return -EINVAL;
+
+	r->kind = k;
+	r->page = p < 0 ? alert_default_page[k] : p;
+	r->next = jiffies;
+	atomic_set(&r->fired, 0);
+	snprintf(r->desc, sizeof(r->desc), "%s@%s %s", kind,
+		 vgadash_page_name(r->page), arg);
+
+	if (k == ALERT_MATCH) {
+		size_t len = strlen(arg);
+
+		if (len > ALERT_PAT_MAX)
+			return -EINVAL;
+		r->ts = textsearch_prepare("kmp", arg, len, GFP_KERNEL, TS_AUTOLOAD);
+		if (IS_ERR(r->ts)) {
+			ret = PTR_ERR(r->ts);
+			r->ts = NULL;
+			return ret;
+		}
+		return 0;
+	}
+
+	ret = kstrtou32(arg, 10, &r->arg);
+	if (ret)
+		return ret;
+	if (k == ALERT_LEVEL ? r->arg > 7 : !r->arg)
+		return -EINVAL;
+	return 0;
+}
+
+static void free_set(struct alert_set *set)
+{
+	int i;
+
+	if (!set)
+		return;
+	for (i = 0; i < set->n; i++) {
+		if (set->rules[i].ts)
+			textsearch_destroy(set->rules[i].ts);
+	}
+	kfree(set);
+}
+
+/* Publish `set` (NULL for none) and free the old one after a grace period */
+static void install_set(struct alert_set *set)
+{
+	struct alert_set *old;
+	bool had_stall;
+
+	mutex_lock(&alert_mutex);
+	old = rcu_dereference_protected(alert_rules, lockdep_is_held(&alert_mutex));
+	had_stall = old && old->on_stall;
+
+	/* Heartbeats for the new rules before the old ones let go */
+	if (set && set->on_stall && !had_stall)
+		vgadash_hb_start();
+	rcu_assign_pointer(alert_rules, set);
+	WRITE_ONCE(alert_on_log, set && set->on_log);
+	if (had_stall && !(set && set->on_stall))
+		vgadash_hb_stop();
+	mutex_unlock(&alert_mutex);
+
+	synchronize_rcu();
+	free_set(old);
+}
+
+int vgadash_alerts_set(char *spec)
+{
+	struct alert_set *set;
+	char *tok;
+	int ret = 0;
+
+	set = kzalloc(sizeof(*set), GFP_KERNEL);
+	if (!set)
+		return -ENOMEM;
+
+	while ((tok = strsep(&spec, ";\n")) != NULL) {
+		struct alert_rule *r;
+
+		tok = strim(tok);
+		if (!*tok || sysfs_streq(tok, "none"))
+			continue;
+		if (set->n == ALERT_MAX_RULES) {
+			ret = -E2BIG;
+			break;
+		}
+		r = &set->rules[set->n++];
+		ret = parse_rule(tok, r);
+		if (ret)
+			break;
+		set->on_log |= r->kind == ALERT_MATCH || r->kind == ALERT_LEVEL;
+		set->on_stall |= r->kind == ALERT_STALL;
+	}
+
+	if (ret) {
+		free_set(set);
+		return ret;
+	}
+
+	if (!set->n) {
+		kfree(set);
+		set = NULL;
+	}
+	install_set(set);
+	return 0;
+}
+
+void vgadash_alerts_show(struct seq_file *m)
+{
+	struct alert_event last;
+	struct alert_set *set;
+	bool have_last;
+	u64 raised, suppressed;
+	int i;
+
+	raw_spin_lock_irq(&alert_lock);
+	last = alert_last;
+	have_last = alert_have_last;
+	raised = alert_raised;
+	suppressed = alert_suppressed;
+	raw_spin_unlock_irq(&alert_lock);
+
+	seq_printf(m, "cooldown_ms=%u raised=%llu suppressed=%llu\n",
+		   alert_cooldown_ms, raised, suppressed);
+
+	mutex_lock(&alert_mutex);
+	set = rcu_dereference_protected(alert_rules, lockdep_is_held(&alert_mutex));
+	for (i = 0; set && i < set->n; i++)
+		seq_printf(m, "%-60s fired=%d\n", set->rules[i].desc,
+			   atomic_read(&set->rules[i].fired));
+	mutex_unlock(&alert_mutex);
+
+	if (!have_last)
+		return;
+	seq_printf(m, "last: %s ", last.desc);
+	if (last.seq != ALERT_NO_SEQ)
+		seq_printf(m, "seq=%llu", last.seq);
+	else
+		seq_printf(m, "value=%llu", last.value);
+	seq_printf(m, " %us ago\n", jiffies_to_msecs(jiffies - last.when) / MSEC_PER_SEC);
+}
+
+void vgadash_alerts_exit(void)
+{
+	install_set(NULL);
+	irq_work_sync(&alert_irq_work);
+	cancel_work_sync(&alert_work);
+}
@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _VGADASH_ALERTS_H_
+#define _VGADASH_ALERTS_H_
+
+#include <linux/seq_file.h>
+#include <linux/types.h>
+
+#define ALERT_MAX_RULES 8
+#define ALERT_PAT_MAX   64 /* match pattern, bytes */
+
+void vgadash_alerts_exit(void);
+
+/*
+ * Replace the rule set, one rule per line or ';':
+ *   match[@page] <text>   a captured record contains <text>
+ *   level[@page] <n>      a captured record has priority <n> or more urgent
+ *   memfree[@page] <MiB>  free memory drops below <MiB>
+ *   stall[@page] <ms>     a CPU misses its heartbeat for <ms>
+ * "" or "none" removes every rule. The whole set is rejected on any error.
+ */
+int  vgadash_alerts_set(char *spec);
+void vgadash_alerts_show(struct seq_file *m);
+
+/* Capture path, any context but NMI: one record just captured */
+void vgadash_alert_log(u64 seq, u8 level, const char *text, unsigned int len);
+
+/* Sampling tick: the threshold rules */
+void vgadash_alert_tick(void);
+
+#endif
@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _BACKEND_H_
+#define _BACKEND_H_
+
+#include <linux/types.h>
+#include <linux/seq_file.h>
+
+/*
+ * An output for finished frames. Backends are attached when the dashboard
+ * is switched on and detached when it goes off; in between, the render
+ * owner hands every frame (VGA_CELLS attr << 8 | ch cells) to flush().
+ * All callbacks run with the render lock held.
+ *
+ * Screen backends drive the local display; only the first of them that
+ * attaches (in table order) is used, which is how fb vs VGA text is chosen.
+ */
+struct vgadash_backend {
+	const char *name;
+	bool screen;
+	int  (*attach)(void);  /* -ENODEV: not present/configured, skip quietly */
+	void (*detach)(void);
+	void (*flush)(const u16 *frame);
+	void (*show)(struct seq_file *m); /* status line for debugfs "backends" */
+};
+
+extern const struct vgadash_backend vgadash_fb_backend;
+extern const struct vgadash_backend vgadash_vga_backend;
+extern const struct vgadash_backend vgadash_serial_backend;
+
+/* Frames and bytes sent by the serial mirror since load */
+void vgadash_serial_stats(u64 *frames, u64 *bytes, u32 *last_bytes);
+
+#endif
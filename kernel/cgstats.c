@@ -0,0 +1,313 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Per-cgroup resource usage.
+ *
+ * While the cgroup page is on screen, the sampling tick walks the default
+ * (v2) hierarchy in pre-order under RCU, at most cg_walk_budget cgroups per
+ * tick. The walk resumes from a referenced cursor, so thousands of cgroups
+ * are covered over several ticks instead of in one long RCU section; the
+ * cursor may be removed in between, css_next_descendant_pre() copes with
+ * that. Every cgroup keeps its own previous sample and timestamp, so rates
+ * stay right however a pass is sliced. Cgroups not seen for a whole pass
+ * are forgotten.
+ *
+ * Counters are read in place. CPU time is the rstat base stat, which the
+ * memcg periodic flush keeps at most ~2 s behind; memory is the memcg page
+ * counter and its watermark; pressure is the PSI "some" 10 s average.
+ * The walk does not descend below cg_depth, so deep trees (containers
+ * inside containers) cost no budget for cgroups that are never shown.
+ * Cgroups are looked up by cgroup id in a hash table over a fixed pool.
+ */
+#include <linux/kernel.h>
+#include <linux/cgroup.h>
+#include <linux/hashtable.h>
+#include <linux/math64.h>
+#include <linux/memcontrol.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/psi_types.h>
+#include <linux/rcupdate.h>
+#include <linux/sched/task.h>
+#include <linux/sort.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+
+#include "vgadash.h"
+#include "cgstats.h"
+
+static unsigned int cg_depth = 2;
+module_param(cg_depth, uint, 0644);
+MODULE_PARM_DESC(cg_depth, "Deepest cgroup level shown on the cgroup page (1 = top level)");
+
+static unsigned int cg_walk_budget = 256;
+module_param(cg_walk_budget, uint, 0644);
+MODULE_PARM_DESC(cg_walk_budget, "Cgroups visited per sampling tick; larger trees take several ticks per pass");
+
+#define CG_HASH_BITS 10
+
+struct cg_ent {
+	struct hlist_node hnode;
+	bool used;
+	bool have_prev;
+	u32 gen;       /* pass that last saw it */
+	u64 id;
+	u64 prev_cpu;  /* ns */
+	u64 prev_ns;
+	struct cg_row row;
+};
+
+static DEFINE_MUTEX(cg_lock);
+static struct cg_ent *cg_table;
+static DEFINE_HASHTABLE(cg_hash, CG_HASH_BITS);
+static u16 cg_free[CG_MAX_GROUPS]; /* unused cg_table slots */
+static int cg_nr_free;
+static u16 cg_order[CG_MAX_GROUPS];
+static u32 cg_gen;
+static bool cg_running;
+
+/* Referenced; NULL starts the next pass at the root */
+static struct cgroup_subsys_state *cg_cursor;
+
+static u32 cg_pass_ticks;
+static u32 cg_pass_skipped;
+static struct cg_walk_stats cg_stats;
+
+static struct cg_ent *cg_find(u64 id)
+{
+	struct cg_ent *e;
+
+	hash_for_each_possible(cg_hash, e, hnode, id) {
+		if (e->id == id)
+			return e;
+	}
+
+	/* Table full: the cgroup is simply not shown */
+	if (!cg_nr_free)
+		return NULL;
+
+	e = &cg_table[cg_free[--cg_nr_free]];
+	memset(e, 0, sizeof(*e));
+	e->used = true;
+	e->id = id;
+	hash_add(cg_hash, &e->hnode, id);
+	return e;
+}
+
+static void cg_forget(int idx)
+{
+	hash_del(&cg_table[idx].hnode);
+	cg_table[idx].used = false;
+	cg_free[cg_nr_free++] = idx;
+}
+
+static void cg_read_mem(struct cgroup *cgrp, struct cg_row *r)
+{
+#ifdef CONFIG_MEMCG
+	struct cgroup_subsys_state *css;
+	struct mem_cgroup *memcg;
+
+	/* NULL unless the parent enabled the controller for it */
+	css = rcu_dereference(cgrp->subsys[memory_cgrp_id]);
+	if (!css) {
+		r->has_mem = false;
+		return;
+	}
+
+	memcg = mem_cgroup_from_css(css);
+	r->mem_cur  = (u64)page_counter_read(&memcg->memory) << PAGE_SHIFT;
+	r->mem_peak = (u64)READ_ONCE(memcg->memory.watermark) << PAGE_SHIFT;
+	r->has_mem  = true;
+#endif
+}
+
+static void cg_read_psi(struct cgroup *cgrp, struct cg_row *r)
+{
+#ifdef CONFIG_PSI
+	struct psi_group *psi = &cgrp->psi;
+
+	r->psi_cpu = READ_ONCE(psi->avg[PSI_CPU_SOME][0]);
+	r->psi_mem = READ_ONCE(psi->avg[PSI_MEM_SOME][0]);
+	r->psi_io  = READ_ONCE(psi->avg[PSI_IO_SOME][0]);
+#endif
+}
+
+/* Called under rcu_read_lock() */
+static void cg_visit(struct cgroup *cgrp, u64 now)
+{
+	struct cg_ent *e;
+	u64 cpu;
+
+	if (cgrp->level < 1 || cgrp->level > READ_ONCE(cg_depth))
+		return;
+
+	e = cg_find(cgroup_id(cgrp));
+	if (!e) {
+		cg_pass_skipped++;
+		return;
+	}
+
+	if (!e->row.name[0]) {
+		cgroup_path(cgrp, e->row.name, sizeof(e->row.name));
+		e->row.level = cgrp->level;
+	}
+
+	cpu = READ_ONCE(cgrp->bstat.cputime.sum_exec_runtime);
+	if (e->have_prev && now > e->prev_ns && cpu >= e->prev_cpu)
+		e->row.cpu_x100 = min_t(u64, U32_MAX,
+					div64_u64((cpu - e->prev_cpu) * 10000, now - e->prev_ns));
+	e->prev_cpu = cpu;
+	e->prev_ns = now;
+	e->have_prev = true;
+	e->gen = cg_gen;
+
+	cg_read_mem(cgrp, &e->row);
+	cg_read_psi(cgrp, &e->row);
+}
+
+static void cg_pass_done(void)
+{
+	u32 n = 0;
+	int i;
+
+	/* Forget cgroups that went away or moved below cg_depth */
+	for (i = 0; i < CG_MAX_GROUPS; i++) {
+		if (!cg_table[i].used)
+			continue;
+		if (cg_table[i].gen != cg_gen)
+			cg_forget(i);
+		else
+			n++;
+	}
+
+	cg_gen++;
+	cg_stats.passes++;
+	cg_stats.depth = READ_ONCE(cg_depth);
+	cg_stats.groups = n;
+	cg_stats.skipped = cg_pass_skipped;
+	cg_stats.ticks = cg_pass_ticks;
+	cg_pass_ticks = 0;
+	cg_pass_skipped = 0;
+}
+
+static void cg_walk(void)
+{
+	struct cgroup_subsys_state *root, *pos, *prev = cg_cursor;
+	unsigned int budget = max(READ_ONCE(cg_walk_budget), 1U);
+	unsigned int depth = READ_ONCE(cg_depth);
+	unsigned int n;
+	u64 now = ktime_get_ns();
+
+	rcu_read_lock();
+	root = &task_dfl_cgroup(&init_task)->self;
+	pos = prev;
+	for (n = 0; n < budget; n++) {
+		pos = css_next_descendant_pre(pos, root);
+		if (!pos)
+			break;
+		cg_visit(pos->cgroup, now);
+
+		/* Nothing below is shown: skip the subtree without visiting it */
+		if (pos->cgroup->level >= depth)
+			pos = css_rightmost_descendant(pos);
+	}
+
+	/*
+	 * Park on the last cgroup visited. Only a css whose last reference is
+	 * already gone refuses the tryget; the pass then restarts at the root.
+	 */
+	cg_cursor = NULL;
+	if (pos && css_tryget(pos))
+		cg_cursor = pos;
+	rcu_read_unlock();
+
+	if (prev)
+		css_put(prev);
+
+	cg_pass_ticks++;
+	if (!pos)
+		cg_pass_done();
+}
+
+void vgadash_cg_tick(void)
+{
+	mutex_lock(&cg_lock);
+	if (cg_running)
+		cg_walk();
+	mutex_unlock(&cg_lock);
+}
+
+void vgadash_cg_start(void)
+{
+	int i;
+
+	mutex_lock(&cg_lock);
+	if (!cg_running) {
+		cg_table = kvcalloc(CG_MAX_GROUPS, sizeof(*cg_table), GFP_KERNEL);
+		if (cg_table) {
+			hash_init(cg_hash);
+			for (i = 0; i < CG_MAX_GROUPS; i++)
+				cg_free[i] = CG_MAX_GROUPS - 1 - i;
+			cg_nr_free = CG_MAX_GROUPS;
+			cg_pass_ticks = 0;
+			cg_pass_skipped = 0;
+			memset(&cg_stats, 0, sizeof(cg_stats));
+			cg_running = true;
+		}
+	}
+	mutex_unlock(&cg_lock);
+}
+
+void vgadash_cg_stop(void)
+{
+	mutex_lock(&cg_lock);
+	cg_running = false;
+	if (cg_cursor) {
+		css_put(cg_cursor);
+		cg_cursor = NULL;
+	}
+	kvfree(cg_table);
+	cg_table = NULL;
+	mutex_unlock(&cg_lock);
+}
+
+static int cg_cmp(const void *a, const void *b)
+{
+	const struct cg_row *ra = &cg_table[*(const u16 *)a].row;
+	const struct cg_row *rb = &cg_table[*(const u16 *)b].row;
+
+	if (ra->cpu_x100 != rb->cpu_x100)
+		return (ra->cpu_x100 > rb->cpu_x100) ? -1 : 1;
+	if (ra->mem_cur != rb->mem_cur)
+		return (ra->mem_cur > rb->mem_cur) ? -1 : 1;
+	return 0;
+}
+
+int vgadash_cg_top(struct cg_row *out, int max)
+{
+	int i, n = 0;
+
+	mutex_lock(&cg_lock);
+	if (cg_running) {
+		for (i = 0; i < CG_MAX_GROUPS; i++) {
+			if (cg_table[i].used)
+				cg_order[n++] = i;
+		}
+	}
+
+	sort(cg_order, n, sizeof(cg_order[0]), cg_cmp, NULL);
+
+	n = min(n, max);
+	for (i = 0; i < n; i++)
+		out[i] = cg_table[cg_order[i]].row;
+	mutex_unlock(&cg_lock);
+
+	return n;
+}
+
+void vgadash_cg_walk_stats(struct cg_walk_stats *ws)
+{
+	mutex_lock(&cg_lock);
+	*ws = cg_stats;
+	mutex_unlock(&cg_lock);
+}
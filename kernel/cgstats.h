@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _CGSTATS_H_
+#define _CGSTATS_H_
+
+#include <linux/types.h>
+
+#define CG_MAX_GROUPS 1024
+#define CG_NAME_LEN   64
+
+/* One cgroup as of its last visit by the walk */
+struct cg_row {
+	char name[CG_NAME_LEN]; /* path from the root, truncated */
+	u8 level;
+	bool has_mem;           /* memory controller enabled on it */
+	u32 cpu_x100;           /* CPU use in hundredths of a percent: 15000 = 1.5 CPUs */
+	u64 mem_cur;            /* bytes */
+	u64 mem_peak;           /* bytes, high watermark */
+	unsigned long psi_cpu;  /* "some" avg10, percent in FIXED_1 units */
+	unsigned long psi_mem;
+	unsigned long psi_io;
+};
+
+/* As of the last completed pass */
+struct cg_walk_stats {
+	u64 passes;    /* full walks completed */
+	u32 depth;
+	u32 groups;    /* cgroups recorded */
+	u32 skipped;   /* cgroups that did not fit the table */
+	u32 ticks;     /* sampling ticks the pass took */
+};
+
+void vgadash_cg_start(void);
+void vgadash_cg_stop(void);
+
+/* Called from the sampling tick; no-op unless the cgroup page started sampling */
+void vgadash_cg_tick(void);
+
+/* Copy up to `max` cgroups, busiest (CPU, then memory) first; returns rows filled */
+int vgadash_cg_top(struct cg_row *out, int max);
+
+void vgadash_cg_walk_stats(struct cg_walk_stats *ws);
+
+#endif
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/cpu.h>
+#include <linux/cpuhotplug.h>
+
+#include "vgadash.h"
+#include "cpu_timers.h"
+
+static enum cpuhp_state cpu_timers_state = CPUHP_INVALID;
+
+/* Hotplug callbacks: run on @cpu itself, from its hotplug thread */
+static int cpu_timer_online(unsigned int cpu, struct hlist_node *node)
+{
+	struct vgadash_cpu_timers *ct = hlist_entry(node, struct vgadash_cpu_timers, node);
+	struct hrtimer *t = per_cpu_ptr(ct->timers, cpu);
+
+	if (ct->online)
+		ct->online(cpu);
+
+	hrtimer_init(t, CLOCK_MONOTONIC, HRTIMER_MODE_REL_PINNED_HARD);
+	t->function = ct->fn;
+	hrtimer_start(t, ct->period, HRTIMER_MODE_REL_PINNED_HARD);
+	cpumask_set_cpu(cpu, &ct->armed);
+	return 0;
+}
+
+static int cpu_timer_offline(unsigned int cpu, struct hlist_node *node)
+{
+	struct vgadash_cpu_timers *ct = hlist_entry(node, struct vgadash_cpu_timers, node);
+
+	/* Readers stop looking at the CPU before its timer goes */
+	cpumask_clear_cpu(cpu, &ct->armed);
+	hrtimer_cancel(per_cpu_ptr(ct->timers, cpu));
+	return 0;
+}
+
+int vgadash_cpu_timers_init(void)
+{
+	int ret;
+
+	ret = cpuhp_setup_state_multi(CPUHP_AP_ONLINE_DYN, VGADASH_NAME "/timers:online",
+				      cpu_timer_online, cpu_timer_offline);
+	if (ret < 0)
+		return ret;
+
+	cpu_timers_state = ret;
+	return 0;
+}
+
+void vgadash_cpu_timers_exit(void)
+{
+	if (cpu_timers_state != CPUHP_INVALID)
+		cpuhp_remove_multi_state(cpu_timers_state);
+	cpu_timers_state = CPUHP_INVALID;
+}
+
+void vgadash_cpu_timers_start(struct vgadash_cpu_timers *ct)
+{
+	int ret;
+
+	cpumask_clear(&ct->armed);
+	if (cpu_timers_state == CPUHP_INVALID)
+		return;
+
+	/* Arms every online CPU now, and each CPU that comes up later */
+	ret = cpuhp_state_add_instance(cpu_timers_state, &ct->node);
+	if (ret)
+		pr_warn(VGADASH_NAME ": per-CPU timers not armed: %d\n", ret);
+	else
+		ct->added = true;
+}
+
+void vgadash_cpu_timers_cancel(struct vgadash_cpu_timers *ct)
+{
+	if (ct->added)
+		cpuhp_state_remove_instance(cpu_timers_state, &ct->node);
+	ct->added = false;
+
+	cpumask_clear(&ct->armed);
+}
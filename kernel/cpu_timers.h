@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _VGADASH_CPU_TIMERS_H_
+#define _VGADASH_CPU_TIMERS_H_
+
+#include <linux/cpumask.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
+
+/*
+ * A pinned, hard-irq hrtimer on every online CPU. Sampling needs no
+ * cross-CPU calls: each timer fires and records on its own CPU. Only arming
+ * touches the remote CPU, once per CPU, from the CPU hotplug callback that
+ * runs there, which may cost a reschedule IPI.
+ *
+ * The set follows CPU hotplug: a CPU going down cancels its timer on the way
+ * (instead of having it migrate and fire on another CPU) and leaves armed; a
+ * CPU coming up gets its timer armed and joins armed again.
+ */
+struct vgadash_cpu_timers {
+	struct hrtimer __percpu *timers;
+	enum hrtimer_restart (*fn)(struct hrtimer *t);
+	/* Optional: on the CPU, before its timer is armed */
+	void (*online)(unsigned int cpu);
+	ktime_t period;
+	struct cpumask armed;
+	struct hlist_node node;
+	bool added;
+};
+
+int  vgadash_cpu_timers_init(void);
+void vgadash_cpu_timers_exit(void);
+
+void vgadash_cpu_timers_start(struct vgadash_cpu_timers *ct);
+void vgadash_cpu_timers_cancel(struct vgadash_cpu_timers *ct);
+
+#endif
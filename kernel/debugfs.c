@@ -1,11 +1,19 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <linux/kernel.h>
 #include <linux/debugfs.h>
+#include <linux/err.h>
 #include <linux/uaccess.h>
 #include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/string.h>
 
 #include "vgadash.h"
 #include "pages.h"
+#include "metrics.h"
+#include "logtap.h"
+#include "recorder.h"
+#include "frame.h"
+#include "alerts.h"
 
 static ssize_t toggle_write(struct file *f, const char __user *ubuf,
 			    size_t len, loff_t *ppos)
@@ -24,19 +32,18 @@ static ssize_t page_read(struct file *f, char __user *ubuf,
 			 size_t len, loff_t *ppos)
 {
 	char buf[16];
+	int n;
 
-	if (g_vgadash.page == VGADASH_PAGE_STATE)
-		strscpy(buf, "state\n", sizeof(buf));
-	else
-		strscpy(buf, "logs\n", sizeof(buf));
+	n = scnprintf(buf, sizeof(buf), "%s\n", vgadash_page_name(g_vgadash.page));
 
-	return simple_read_from_buffer(ubuf, len, ppos, buf, strlen(buf));
+	return simple_read_from_buffer(ubuf, len, ppos, buf, n);
 }
 
 static ssize_t page_write(struct file *f, const char __user *ubuf,
 			  size_t len, loff_t *ppos)
 {
 	char buf[16];
+	int p;
 
 	if (len == 0)
 		return 0;
@@ -47,12 +54,11 @@ static ssize_t page_write(struct file *f, const char __user *ubuf,
 		return -EFAULT;
 	buf[len] = '\0';
 
-	if (!strncmp(buf, "state", 5))
-		vgadash_set_page(VGADASH_PAGE_STATE);
-	else if (!strncmp(buf, "logs", 4))
-		vgadash_set_page(VGADASH_PAGE_LOGS);
-	else
-		return -EINVAL;
+	p = vgadash_page_by_name(buf);
+	if (p < 0)
+		return p;
+
+	vgadash_set_page(p);
 
 	return len;
 }
@@ -64,24 +70,182 @@ static const struct file_operations page_fops = {
 	.llseek = no_llseek,
 };
 
+static ssize_t logview_read(struct file *f, char __user *ubuf,
+			    size_t len, loff_t *ppos)
+{
+	char buf[32];
+	int n;
+
+	n = vgadash_logtap_mask_str(READ_ONCE(g_vgadash.log_view), buf, sizeof(buf) - 1);
+	n += scnprintf(buf + n, sizeof(buf) - n, "\n");
+
+	return simple_read_from_buffer(ubuf, len, ppos, buf, n);
+}
+
+static ssize_t logview_write(struct file *f, const char __user *ubuf,
+			     size_t len, loff_t *ppos)
+{
+	char buf[32];
+	u32 mask;
+	int ret;
+
+	if (len == 0)
+		return 0;
+	if (len >= sizeof(buf))
+		len = sizeof(buf) - 1;
+
+	if (copy_from_user(buf, ubuf, len))
+		return -EFAULT;
+	buf[len] = '\0';
+
+	mask = vgadash_logtap_parse_mask(buf);
+	ret = vgadash_set_log_view(mask);
+	if (ret)
+		return ret;
+
+	return len;
+}
+
+static const struct file_operations logview_fops = {
+	.owner  = THIS_MODULE,
+	.read   = logview_read,
+	.write  = logview_write,
+	.llseek = no_llseek,
+};
+
+#define CTL_BUF_SIZE 256
+
+static ssize_t ctl_read(struct file *f, char __user *ubuf,
+			size_t len, loff_t *ppos)
+{
+	char view[32], pos[64], buf[176];
+	int n;
+
+	vgadash_logtap_mask_str(READ_ONCE(g_vgadash.log_view), view, sizeof(view));
+	page_logs_position(pos, sizeof(pos));
+	n = scnprintf(buf, sizeof(buf), "page=%s active=%d logview=%s logs=%s\n",
+		      vgadash_page_name(READ_ONCE(g_vgadash.page)),
+		      READ_ONCE(g_vgadash.active) ? 1 : 0, view, pos);
+
+	return simple_read_from_buffer(ubuf, len, ppos, buf, n);
+}
+
+/* One write is one batch: "page logs; logview crit,warn; scroll pgup; on" */
+static ssize_t ctl_write(struct file *f, const char __user *ubuf,
+			 size_t len, loff_t *ppos)
+{
+	char buf[CTL_BUF_SIZE];
+	int ret;
+
+	if (len == 0)
+		return 0;
+	if (len >= sizeof(buf))
+		return -E2BIG;
+
+	if (copy_from_user(buf, ubuf, len))
+		return -EFAULT;
+	buf[len] = '\0';
+
+	ret = vgadash_ctl(buf);
+	if (ret)
+		return ret;
+
+	return len;
+}
+
+static const struct file_operations ctl_fops = {
+	.owner  = THIS_MODULE,
+	.read   = ctl_read,
+	.write  = ctl_write,
+	.llseek = no_llseek,
+};
+
+struct snapshot_state {
+	u64 gen;  /* generation last returned to this reader */
+};
+
+/* Row y of a frame as printable text, trailing blanks trimmed; returns length */
+static int frame_row_text(const struct vgadash_frame *f, int y, char *line)
+{
+	int x, end = 0;
+
+	for (x = 0; x < VGA_COLS; x++) {
+		u8 ch = f->cells[y * VGA_COLS + x] & 0xFF;
+
+		line[x] = (ch >= 0x20 && ch < 0x7F) ? ch : ' ';
+		if (line[x] != ' ')
+			end = x + 1;
+	}
+	line[end] = '\0';
+	return end;
+}
+
+/* The published frame, one line per row below the header */
 static int snapshot_show(struct seq_file *m, void *v)
 {
-	seq_printf(m, "VGADASH page=%s active=%d\n",
-		   (g_vgadash.page == VGADASH_PAGE_STATE) ? "state" : "logs",
-		   g_vgadash.active ? 1 : 0);
+	struct snapshot_state *st = m->private;
+	struct vgadash_frame *f;
+	char line[VGA_COLS + 1];
+	int y;
+
+	rcu_read_lock();
+	f = vgadash_frame_get();
+	if (!f) {
+		rcu_read_unlock();
+		seq_puts(m, "VGADASH (no frame yet)\n");
+		return 0;
+	}
+
+	seq_printf(m, "VGADASH page=%s active=%d gen=%llu\n",
+		   vgadash_page_name(f->page),
+		   READ_ONCE(g_vgadash.active) ? 1 : 0, f->gen);
 	seq_puts(m, "--------------------------------------------------------------------------------\n");
 
-	if (g_vgadash.page == VGADASH_PAGE_STATE)
-		page_state_snapshot(m);
-	else
-		page_logs_snapshot(m);
+	for (y = 2; y < VGA_ROWS; y++) {
+		frame_row_text(f, y, line);
+		seq_printf(m, "%s\n", line);
+	}
+
+	st->gen = f->gen;
+	rcu_read_unlock();
 
 	return 0;
 }
 
 static int snapshot_open(struct inode *inode, struct file *file)
 {
-	return single_open(file, snapshot_show, NULL);
+	struct snapshot_state *st;
+	int ret;
+
+	st = kzalloc(sizeof(*st), GFP_KERNEL);
+	if (!st)
+		return -ENOMEM;
+
+	/* While off nothing redraws; have the owner render one frame for us */
+	if (!READ_ONCE(g_vgadash.active))
+		vgadash_request_frame();
+
+	ret = single_open(file, snapshot_show, st);
+	if (ret)
+		kfree(st);
+	return ret;
+}
+
+/* Readable once a frame newer than the one last read has been published */
+static __poll_t snapshot_poll(struct file *file, poll_table *pt)
+{
+	struct seq_file *m = file->private_data;
+	struct snapshot_state *st = m->private;
+
+	return vgadash_frame_poll(file, pt, READ_ONCE(st->gen));
+}
+
+static int snapshot_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+
+	kfree(m->private);
+	return single_release(inode, file);
 }
 
 static const struct file_operations snapshot_fops = {
@@ -89,9 +253,344 @@ static const struct file_operations snapshot_fops = {
 	.open    = snapshot_open,
 	.read    = seq_read,
 	.llseek  = seq_lseek,
+	.poll    = snapshot_poll,
+	.release = snapshot_release,
+};
+
+/*
+ * Delta snapshot. Each read from offset 0 (pread, or lseek back) returns the
+ * rows that changed since the generation this reader last saw, or the one
+ * written to the file, as "<row> <text>" lines after a header. "full=1"
+ * means the history no longer reaches back that far and every row follows.
+ */
+#define DELTA_BUF_SIZE (96 + VGA_ROWS * (VGA_COLS + 4))
+
+struct delta_state {
+	u64 base;
+	size_t len;
+	char buf[DELTA_BUF_SIZE];
+};
+
+static int delta_open(struct inode *inode, struct file *file)
+{
+	struct delta_state *st;
+
+	st = kzalloc(sizeof(*st), GFP_KERNEL);
+	if (!st)
+		return -ENOMEM;
+
+	if (!READ_ONCE(g_vgadash.active))
+		vgadash_request_frame();
+
+	file->private_data = st;
+	return 0;
+}
+
+static void delta_build(struct delta_state *st)
+{
+	struct vgadash_frame *f;
+	char line[VGA_COLS + 1];
+	bool full;
+	u32 rows;
+	size_t n = 0;
+	int y;
+
+	rcu_read_lock();
+	f = vgadash_frame_get();
+	if (!f) {
+		rcu_read_unlock();
+		st->len = scnprintf(st->buf, sizeof(st->buf), "VGADASH (no frame yet)\n");
+		return;
+	}
+
+	rows = vgadash_frame_dirty_since(f, st->base, &full);
+	n += scnprintf(st->buf + n, sizeof(st->buf) - n,
+		       "VGADASH page=%s active=%d gen=%llu base=%llu full=%d\n",
+		       vgadash_page_name(f->page), READ_ONCE(g_vgadash.active) ? 1 : 0,
+		       f->gen, st->base, full ? 1 : 0);
+
+	for (y = 0; y < VGA_ROWS; y++) {
+		if (!(rows & (1U << y)))
+			continue;
+		frame_row_text(f, y, line);
+		n += scnprintf(st->buf + n, sizeof(st->buf) - n, "%02d %s\n", y, line);
+	}
+
+	st->base = f->gen;
+	rcu_read_unlock();
+
+	st->len = n;
+}
+
+static ssize_t delta_read(struct file *f, char __user *ubuf,
+			  size_t len, loff_t *ppos)
+{
+	struct delta_state *st = f->private_data;
+
+	/* A new read cycle starts at offset 0; continuing reads see the same text */
+	if (*ppos == 0)
+		delta_build(st);
+
+	return simple_read_from_buffer(ubuf, len, ppos, st->buf, st->len);
+}
+
+/* Writing a generation makes the next read a delta against it (0 = full) */
+static ssize_t delta_write(struct file *f, const char __user *ubuf,
+			   size_t len, loff_t *ppos)
+{
+	struct delta_state *st = f->private_data;
+	u64 gen;
+	int ret;
+
+	ret = kstrtou64_from_user(ubuf, len, 10, &gen);
+	if (ret)
+		return ret;
+
+	st->base = gen;
+	*ppos = 0;
+	return len;
+}
+
+static __poll_t delta_poll(struct file *file, poll_table *pt)
+{
+	struct delta_state *st = file->private_data;
+
+	return vgadash_frame_poll(file, pt, READ_ONCE(st->base));
+}
+
+static int delta_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+	return 0;
+}
+
+static const struct file_operations delta_fops = {
+	.owner   = THIS_MODULE,
+	.open    = delta_open,
+	.read    = delta_read,
+	.write   = delta_write,
+	.poll    = delta_poll,
+	.llseek  = default_llseek,
+	.release = delta_release,
+};
+
+static int backends_show(struct seq_file *m, void *v)
+{
+	vgadash_backends_show(m);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(backends);
+
+static int prev_boot_show(struct seq_file *m, void *v)
+{
+	page_prev_details(m);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(prev_boot);
+
+#define LAYOUT_BUF_SIZE 128
+
+static int layout_show(struct seq_file *m, void *v)
+{
+	vgadash_layout_show(m);
+	return 0;
+}
+
+static int layout_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, layout_show, NULL);
+}
+
+/* "state:6@1000 logs@250": page[:rows][@ms] per tile, top to bottom */
+static ssize_t layout_write(struct file *f, const char __user *ubuf,
+			    size_t len, loff_t *ppos)
+{
+	char buf[LAYOUT_BUF_SIZE];
+	int ret;
+
+	if (len == 0)
+		return 0;
+	if (len >= sizeof(buf))
+		return -E2BIG;
+
+	if (copy_from_user(buf, ubuf, len))
+		return -EFAULT;
+	buf[len] = '\0';
+
+	ret = vgadash_set_layout(buf);
+	if (ret)
+		return ret;
+
+	return len;
+}
+
+static const struct file_operations layout_fops = {
+	.owner   = THIS_MODULE,
+	.open    = layout_open,
+	.read    = seq_read,
+	.write   = layout_write,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+#define ALERTS_BUF_SIZE 1024
+
+static int alerts_show(struct seq_file *m, void *v)
+{
+	vgadash_alerts_show(m);
+	return 0;
+}
+
+static int alerts_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, alerts_show, NULL);
+}
+
+/* "match oom-killer; memfree 256; stall@oncpu 200": the whole rule set */
+static ssize_t alerts_write(struct file *f, const char __user *ubuf,
+			    size_t len, loff_t *ppos)
+{
+	char *buf;
+	int ret;
+
+	if (len == 0)
+		return 0;
+	if (len >= ALERTS_BUF_SIZE)
+		return -E2BIG;
+
+	buf = memdup_user_nul(ubuf, len);
+	if (IS_ERR(buf))
+		return PTR_ERR(buf);
+
+	ret = vgadash_alerts_set(buf);
+	kfree(buf);
+	if (ret)
+		return ret;
+
+	return len;
+}
+
+static const struct file_operations alerts_fops = {
+	.owner   = THIS_MODULE,
+	.open    = alerts_open,
+	.read    = seq_read,
+	.write   = alerts_write,
+	.llseek  = seq_lseek,
 	.release = single_release,
 };
 
+/* Per-page text form: rebuilt from the cached data, may exceed one screen */
+static int details_show(struct seq_file *m, void *v)
+{
+	enum vgadash_page p = READ_ONCE(g_vgadash.page);
+
+	seq_printf(m, "VGADASH page=%s active=%d\n",
+		   vgadash_page_name(p), READ_ONCE(g_vgadash.active) ? 1 : 0);
+	seq_puts(m, "--------------------------------------------------------------------------------\n");
+
+	vgadash_pages[p].details(m);
+
+	return 0;
+}
+
+static int details_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, details_show, NULL);
+}
+
+static const struct file_operations details_fops = {
+	.owner   = THIS_MODULE,
+	.open    = details_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+struct file_copy {
+	size_t len;
+	char *text;
+};
+
+/* Take a private copy on open so a slow reader never holds up the sampler */
+static int metrics_open(struct inode *inode, struct file *file)
+{
+	struct file_copy *mc;
+
+	mc = kmalloc(sizeof(*mc), GFP_KERNEL);
+	if (!mc)
+		return -ENOMEM;
+
+	mc->text = vgadash_metrics_dup(&mc->len);
+	if (!mc->text) {
+		kfree(mc);
+		return -ENOMEM;
+	}
+
+	file->private_data = mc;
+	return 0;
+}
+
+static ssize_t metrics_read(struct file *f, char __user *ubuf,
+			    size_t len, loff_t *ppos)
+{
+	struct file_copy *mc = f->private_data;
+
+	return simple_read_from_buffer(ubuf, len, ppos, mc->text, mc->len);
+}
+
+static int metrics_release(struct inode *inode, struct file *file)
+{
+	struct file_copy *mc = file->private_data;
+
+	kfree(mc->text);
+	kfree(mc);
+	return 0;
+}
+
+static const struct file_operations metrics_fops = {
+	.owner   = THIS_MODULE,
+	.open    = metrics_open,
+	.read    = metrics_read,
+	.llseek  = default_llseek,
+	.release = metrics_release,
+};
+
+/* Same private-copy scheme as metrics, over the whole recording */
+static int recording_open(struct inode *inode, struct file *file)
+{
+	struct file_copy *mc;
+
+	mc = kmalloc(sizeof(*mc), GFP_KERNEL);
+	if (!mc)
+		return -ENOMEM;
+
+	mc->text = vgadash_recorder_export(&mc->len);
+	if (!mc->text) {
+		kfree(mc);
+		return -ENOMEM;
+	}
+
+	file->private_data = mc;
+	return 0;
+}
+
+static int recording_release(struct inode *inode, struct file *file)
+{
+	struct file_copy *mc = file->private_data;
+
+	kvfree(mc->text);
+	kfree(mc);
+	return 0;
+}
+
+static const struct file_operations recording_fops = {
+	.owner   = THIS_MODULE,
+	.open    = recording_open,
+	.read    = metrics_read,
+	.llseek  = default_llseek,
+	.release = recording_release,
+};
+
 int vgadash_debugfs_init(void)
 {
 	g_vgadash.dbg_dir = debugfs_create_dir("vgadash", NULL);
@@ -100,7 +599,17 @@ int vgadash_debugfs_init(void)
 
 	debugfs_create_file("toggle", 0200, g_vgadash.dbg_dir, NULL, &toggle_fops);
 	debugfs_create_file("page",   0600, g_vgadash.dbg_dir, NULL, &page_fops);
+	debugfs_create_file("logview", 0600, g_vgadash.dbg_dir, NULL, &logview_fops);
+	debugfs_create_file("ctl",    0600, g_vgadash.dbg_dir, NULL, &ctl_fops);
+	debugfs_create_file("layout", 0600, g_vgadash.dbg_dir, NULL, &layout_fops);
+	debugfs_create_file("alerts", 0600, g_vgadash.dbg_dir, NULL, &alerts_fops);
 	debugfs_create_file("snapshot", 0400, g_vgadash.dbg_dir, NULL, &snapshot_fops);
+	debugfs_create_file("details", 0400, g_vgadash.dbg_dir, NULL, &details_fops);
+	debugfs_create_file("delta",  0600, g_vgadash.dbg_dir, NULL, &delta_fops);
+	debugfs_create_file("backends", 0400, g_vgadash.dbg_dir, NULL, &backends_fops);
+	debugfs_create_file("metrics", 0400, g_vgadash.dbg_dir, NULL, &metrics_fops);
+	debugfs_create_file("recording", 0400, g_vgadash.dbg_dir, NULL, &recording_fops);
+	debugfs_create_file("prev_boot", 0400, g_vgadash.dbg_dir, NULL, &prev_boot_fops);
 
 	return 0;
 }
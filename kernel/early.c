@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Early boot mode, built in only (CONFIG_VGADASH=y).
+ *
+ * The console tap registers from a console_initcall instead of at load, and
+ * CON_PRINTBUFFER hands it every record printed before that, so the static
+ * rings hold the boot from the first printk on. With vgadash.boot_on=1 the
+ * captured tail is also painted on a VGA text screen as records come in,
+ * at most every early_paint_ms so a printk storm is not slowed down by a
+ * full repaint per line. That is the panic painter: no workqueue, timer or
+ * allocation, nothing that is not up yet this early. When the rest of the
+ * driver initialises the painter stops and the regular dashboard comes up
+ * in its place.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/screen_info.h>
+#include <linux/timekeeping.h>
+
+#include "vgadash.h"
+#include "vga_text.h"
+#include "logtap.h"
+#include "panic.h"
+#include "early.h"
+
+static bool boot_on;
+module_param(boot_on, bool, 0444);
+MODULE_PARM_DESC(boot_on, "Show the dashboard from early boot on (built in only)");
+
+static unsigned int early_paint_ms = 50;
+module_param(early_paint_ms, uint, 0644);
+MODULE_PARM_DESC(early_paint_ms, "Repaint the early boot screen at most this often (0: every record)");
+
+static bool early_painting;
+static u64 early_painted_ns;
+
+void vgadash_early_paint(void)
+{
+	u64 now, last;
+
+	if (!READ_ONCE(early_painting))
+		return;
+
+	/* One CPU takes each slot; the others leave the screen to it */
+	now = ktime_get_mono_fast_ns();
+	last = READ_ONCE(early_painted_ns);
+	if (last && now - last < (u64)READ_ONCE(early_paint_ms) * NSEC_PER_MSEC)
+		return;
+	if (cmpxchg64(&early_painted_ns, last, now) != last)
+		return;
+
+	vgadash_panic_paint_tail("EARLY BOOT");
+}
+
+bool vgadash_early_handoff(void)
+{
+	WRITE_ONCE(early_painting, false);
+	return boot_on;
+}
+
+static int __init vgadash_early_init(void)
+{
+	vgadash_logtap_init();
+
+	/* A framebuffer console waits for the regular dashboard */
+	if (!boot_on || (screen_info.orig_video_isVGA != VIDEO_TYPE_VGAC &&
+			 screen_info.orig_video_isVGA != VIDEO_TYPE_EGAC))
+		return 0;
+	if (vga_text_ensure_mapped(&g_vgadash.vga_mem))
+		return 0;
+
+	WRITE_ONCE(early_painting, true);
+	vgadash_early_paint();
+	return 0;
+}
+console_initcall(vgadash_early_init);
@@ -0,0 +1,19 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _VGADASH_EARLY_H_
+#define _VGADASH_EARLY_H_
+
+#include <linux/kconfig.h>
+#include <linux/types.h>
+
+#if IS_BUILTIN(CONFIG_VGADASH)
+/* Capture path: repaint the early boot screen while it is up */
+void vgadash_early_paint(void);
+
+/* Stop painting; true if the dashboard should now come up (boot_on) */
+bool vgadash_early_handoff(void);
+#else
+static inline void vgadash_early_paint(void) { }
+static inline bool vgadash_early_handoff(void) { return false; }
+#endif
+
+#endif
@@ -0,0 +1,312 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Framebuffer pixel backend.
+ *
+ * When the machine boots into a framebuffer console (efifb, vesafb, bochs,
+ * ...) the text buffer at 0xB8000 is not scanned out, so the cell grid is
+ * drawn onto the linear framebuffer instead, centred, with the kernel's
+ * built-in VGA 8x16 font.
+ *
+ * Glyph scanlines are pre-expanded per attribute: for each attribute in use
+ * a table maps every 8-pixel bit pattern to its four 64-bit pixel pairs, so
+ * a cell scanline is four writeq()s. Only cells that changed since the last
+ * frame are drawn, one text row span at a time.
+ *
+ * The device is held open (/dev/fbN) while attached, so the fb_info and its
+ * mapping stay alive even if a DRM driver kicks the firmware framebuffer
+ * out; drawing stops once fb_index no longer names the same device.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/err.h>
+#include <linux/fb.h>
+#include <linux/font.h>
+#include <linux/fs.h>
+#include <linux/io.h>
+#include <linux/mm.h>
+#include <linux/screen_info.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "vgadash.h"
+#include "backend.h"
+
+#define FB_GLYPH_W 8
+#define FB_GLYPH_H 16
+#define FB_GRID_W  (VGA_COLS * FB_GLYPH_W)
+#define FB_GRID_H  (VGA_ROWS * FB_GLYPH_H)
+#define FB_NR_ATTRS 128  /* blink bit ignored */
+
+static int fb_index;
+module_param(fb_index, int, 0644);
+MODULE_PARM_DESC(fb_index, "Framebuffer used when the console is not in VGA text mode (-1 = never)");
+
+/* Standard VGA palette, 0xRRGGBB */
+static const u32 vga_palette[16] = {
+	0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+	0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF,
+};
+
+struct fb_state {
+	struct file *filp;     /* holds the fb_info while attached */
+	struct fb_info *info;
+	bool gone;             /* unregistered under us: stop drawing */
+	const struct font_desc *font;
+	u8 __iomem *origin;    /* top-left pixel of the grid */
+	u32 pitch;
+	u32 colors[16];        /* palette in the framebuffer's pixel format */
+	u64 *expand[FB_NR_ATTRS];  /* [256 patterns][4] pixel pairs, built on first use */
+	u32 *saved;            /* grid area as it was before attach */
+	u16 shown[VGA_CELLS];
+	bool valid;
+	u64 frames;
+	u64 cells;
+};
+
+static struct fb_state fbs;
+
+static u32 fb_pixel(const struct fb_var_screeninfo *var, u32 rgb)
+{
+	u32 r = (rgb >> 16) & 0xFF, g = (rgb >> 8) & 0xFF, b = rgb & 0xFF;
+
+	return ((r >> (8 - var->red.length)) << var->red.offset) |
+	       ((g >> (8 - var->green.length)) << var->green.offset) |
+	       ((b >> (8 - var->blue.length)) << var->blue.offset);
+}
+
+static const u64 *fb_expansion(u8 attr)
+{
+	u32 fg, bg;
+	u64 *t;
+	int p, k;
+
+	attr &= FB_NR_ATTRS - 1;
+	if (fbs.expand[attr])
+		return fbs.expand[attr];
+
+	t = kmalloc_array(256 * 4, sizeof(u64), GFP_KERNEL);
+	if (!t)
+		return NULL;
+
+	fg = fbs.colors[attr & 0x0F];
+	bg = fbs.colors[(attr >> 4) & 0x07];
+	for (p = 0; p < 256; p++) {
+		for (k = 0; k < 4; k++) {
+			u32 left = (p & (0x80 >> (2 * k))) ? fg : bg;
+			u32 right = (p & (0x40 >> (2 * k))) ? fg : bg;
+
+			t[p * 4 + k] = left | ((u64)right << 32);
+		}
+	}
+
+	fbs.expand[attr] = t;
+	return t;
+}
+
+/* Draw cells [x0, x1) of text row y, scanline by scanline */
+static void fb_draw_span(const u16 *frame, int y, int x0, int x1)
+{
+	const u16 *row = frame + y * VGA_COLS;
+	const u8 *font = fbs.font->data;
+	int x, r;
+
+	for (x = x0; x < x1; x++) {
+		if (!fb_expansion(row[x] >> 8))
+			return;
+	}
+
+	for (r = 0; r < FB_GLYPH_H; r++) {
+		u64 __iomem *dst = (u64 __iomem *)(fbs.origin +
+			(y * FB_GLYPH_H + r) * fbs.pitch + x0 * FB_GLYPH_W * 4);
+
+		for (x = x0; x < x1; x++) {
+			const u64 *e = fbs.expand[(row[x] >> 8) & (FB_NR_ATTRS - 1)] +
+				       font[(row[x] & 0xFF) * FB_GLYPH_H + r] * 4;
+
+			writeq(e[0], dst++);
+			writeq(e[1], dst++);
+			writeq(e[2], dst++);
+			writeq(e[3], dst++);
+		}
+	}
+
+	fbs.cells += x1 - x0;
+}
+
+/* Still the registered device? Racy by design; the open file keeps it valid */
+static bool fb_current(void)
+{
+	if (!fbs.gone && READ_ONCE(registered_fb[fb_index]) != fbs.info) {
+		fbs.gone = true;
+		pr_warn(VGADASH_NAME ": fb%d went away, not drawing on it\n", fb_index);
+	}
+	return !fbs.gone;
+}
+
+static void fb_flush(const u16 *frame)
+{
+	int y, x, x0;
+
+	if (!fb_current())
+		return;
+
+	for (y = 0; y < VGA_ROWS; y++) {
+		const u16 *row = frame + y * VGA_COLS;
+		const u16 *old = fbs.shown + y * VGA_COLS;
+
+		for (x = 0; x < VGA_COLS; ) {
+			if (fbs.valid && row[x] == old[x]) {
+				x++;
+				continue;
+			}
+			for (x0 = x; x < VGA_COLS && (!fbs.valid || row[x] != old[x]); x++)
+				;
+			fb_draw_span(frame, y, x0, x);
+		}
+	}
+
+	memcpy(fbs.shown, frame, sizeof(fbs.shown));
+	fbs.valid = true;
+	fbs.frames++;
+}
+
+/* Only when the console is not in VGA text mode */
+static bool fb_wanted(void)
+{
+	if (fb_index < 0 || fb_index >= FB_MAX)
+		return false;
+	return screen_info.orig_video_isVGA != VIDEO_TYPE_VGAC &&
+	       screen_info.orig_video_isVGA != VIDEO_TYPE_EGAC;
+}
+
+/* 32 bpp packed true colour, at most 8 bits a channel (fb_pixel), big enough */
+static bool fb_usable(const struct fb_info *info)
+{
+	const struct fb_var_screeninfo *var = &info->var;
+
+	if (!info->screen_base)
+		return false;
+	if (var->bits_per_pixel != 32 || info->fix.type != FB_TYPE_PACKED_PIXELS ||
+	    info->fix.visual != FB_VISUAL_TRUECOLOR)
+		return false;
+	if (var->red.length > 8 || var->green.length > 8 || var->blue.length > 8)
+		return false;
+	return var->xres >= FB_GRID_W && var->yres >= FB_GRID_H;
+}
+
+/* Open /dev/fbN and return it with its fb_info; the open pins both */
+static struct file *fb_open(struct fb_info **out)
+{
+	struct fb_info *info;
+	struct file *f;
+	char path[16];
+
+	if (!fb_wanted())
+		return ERR_PTR(-ENODEV);
+
+	snprintf(path, sizeof(path), "/dev/fb%d", fb_index);
+	f = filp_open(path, O_RDWR, 0);
+	if (IS_ERR(f))
+		return f;
+
+	/* fb_open() leaves the fb_info it took a reference on here */
+	info = f->private_data;
+	if (!info || !fb_usable(info)) {
+		filp_close(f, NULL);
+		return ERR_PTR(-ENODEV);
+	}
+
+	*out = info;
+	return f;
+}
+
+static int fb_attach(void)
+{
+	struct fb_info *info;
+	struct file *f;
+	u32 xoff, yoff;
+	int i;
+
+	fbs.font = find_font("VGA8x16");
+	if (!fbs.font)
+		return -ENODEV;
+
+	f = fb_open(&info);
+	if (IS_ERR(f))
+		return PTR_ERR(f);
+
+	fbs.saved = kvmalloc_array(FB_GRID_W * FB_GRID_H, sizeof(u32), GFP_KERNEL);
+	if (!fbs.saved) {
+		filp_close(f, NULL);
+		return -ENOMEM;
+	}
+
+	/* Keep 64-bit writes aligned */
+	xoff = ((info->var.xres - FB_GRID_W) / 2) & ~1U;
+	yoff = (info->var.yres - FB_GRID_H) / 2;
+
+	fbs.filp = f;
+	fbs.info = info;
+	fbs.gone = false;
+	fbs.pitch = info->fix.line_length;
+	fbs.origin = (u8 __iomem *)info->screen_base + yoff * fbs.pitch + xoff * 4;
+	for (i = 0; i < 16; i++)
+		fbs.colors[i] = fb_pixel(&info->var, vga_palette[i]);
+
+	for (i = 0; i < FB_GRID_H; i++)
+		memcpy_fromio(fbs.saved + i * FB_GRID_W, fbs.origin + i * fbs.pitch,
+			      FB_GRID_W * sizeof(u32));
+
+	fbs.valid = false;
+	return 0;
+}
+
+static void fb_detach(void)
+{
+	int i;
+
+	if (fb_current()) {
+		for (i = 0; i < FB_GRID_H; i++)
+			memcpy_toio(fbs.origin + i * fbs.pitch, fbs.saved + i * FB_GRID_W,
+				    FB_GRID_W * sizeof(u32));
+	}
+
+	kvfree(fbs.saved);
+	fbs.saved = NULL;
+	for (i = 0; i < FB_NR_ATTRS; i++) {
+		kfree(fbs.expand[i]);
+		fbs.expand[i] = NULL;
+	}
+	fbs.info = NULL;
+	filp_close(fbs.filp, NULL);
+	fbs.filp = NULL;
+}
+
+static void fb_show(struct seq_file *m)
+{
+	struct fb_info *info;
+	struct file *f;
+
+	if (fbs.info) {
+		seq_printf(m, "fb%d %ux%u frames=%llu cells=%llu%s\n", fb_index,
+			   fbs.info->var.xres, fbs.info->var.yres, fbs.frames, fbs.cells,
+			   fbs.gone ? " gone" : "");
+		return;
+	}
+
+	/* Not attached: look through a short-lived open, never a bare pointer */
+	f = fb_open(&info);
+	seq_printf(m, "fb%d %s\n", fb_index, IS_ERR(f) ? "not usable" : "available");
+	if (!IS_ERR(f))
+		filp_close(f, NULL);
+}
+
+const struct vgadash_backend vgadash_fb_backend = {
+	.name   = "fb",
+	.screen = true,
+	.attach = fb_attach,
+	.detach = fb_detach,
+	.flush  = fb_flush,
+	.show   = fb_show,
+};
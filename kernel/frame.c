@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Frame publication.
+ *
+ * The render owner builds each frame privately, then swaps it in with
+ * rcu_assign_pointer() and frees the old one after a grace period. Snapshot
+ * readers never take the render lock and never see a half-drawn frame.
+ * Pollers sleep on frame_wq until the generation changes.
+ *
+ * Each frame also carries the dirty-row bitmaps of the last FRAME_DIRTY_HIST
+ * generations, so delta readers can tell which rows moved since the
+ * generation they last saw without any lock.
+ */
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+#include <linux/wait.h>
+
+#include "frame.h"
+
+struct vgadash_frame __rcu *vgadash_cur_frame;
+
+#define ALL_ROWS ((u32)((1ULL << VGA_ROWS) - 1))
+
+static DECLARE_WAIT_QUEUE_HEAD(frame_wq);
+static u64 frame_gen;
+
+static u32 rows_changed(const u16 *a, const u16 *b)
+{
+	u32 mask = 0;
+	int y;
+
+	for (y = 0; y < VGA_ROWS; y++) {
+		if (memcmp(a + y * VGA_COLS, b + y * VGA_COLS, VGA_COLS * sizeof(u16)))
+			mask |= 1U << y;
+	}
+	return mask;
+}
+
+void vgadash_frame_publish(const u16 *cells, u8 page)
+{
+	struct vgadash_frame *old, *f;
+
+	/* Only the render owner writes, so a plain dereference is enough here */
+	old = rcu_dereference_protected(vgadash_cur_frame, 1);
+	if (old && old->page == page && !memcmp(old->cells, cells, sizeof(old->cells)))
+		return;
+
+	f = kmalloc(sizeof(*f), GFP_KERNEL);
+	if (!f)
+		return;
+
+	memcpy(f->cells, cells, sizeof(f->cells));
+	f->page = page;
+	f->ts_ns = ktime_get_ns();
+	f->gen = frame_gen + 1;
+
+	if (old)
+		memcpy(f->dirty, old->dirty, sizeof(f->dirty));
+	else
+		memset(f->dirty, 0, sizeof(f->dirty));
+	f->dirty[f->gen % FRAME_DIRTY_HIST] = old ? rows_changed(old->cells, cells) : ALL_ROWS;
+
+	rcu_assign_pointer(vgadash_cur_frame, f);
+	WRITE_ONCE(frame_gen, f->gen);
+	if (old)
+		kfree_rcu(old, rcu);
+
+	wake_up_interruptible(&frame_wq);
+}
+
+u64 vgadash_frame_gen(void)
+{
+	return READ_ONCE(frame_gen);
+}
+
+u32 vgadash_frame_dirty_since(const struct vgadash_frame *f, u64 base, bool *full)
+{
+	u32 mask = 0;
+	u64 g;
+
+	*full = !base || base > f->gen || f->gen - base > FRAME_DIRTY_HIST;
+	if (*full)
+		return ALL_ROWS;
+
+	for (g = base + 1; g <= f->gen; g++)
+		mask |= f->dirty[g % FRAME_DIRTY_HIST];
+	return mask;
+}
+
+__poll_t vgadash_frame_poll(struct file *file, poll_table *pt, u64 seen)
+{
+	poll_wait(file, &frame_wq, pt);
+
+	return vgadash_frame_gen() != seen ? EPOLLIN | EPOLLRDNORM : 0;
+}
+
+void vgadash_frame_exit(void)
+{
+	struct vgadash_frame *f;
+
+	f = rcu_replace_pointer(vgadash_cur_frame, NULL, 1);
+	synchronize_rcu();
+	kfree(f);
+}
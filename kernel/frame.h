@@ -0,0 +1,52 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _FRAME_H_
+#define _FRAME_H_
+
+#include <linux/types.h>
+#include <linux/rcupdate.h>
+#include <linux/poll.h>
+
+#include "vgadash.h"
+
+#define FRAME_DIRTY_HIST 64 /* generations a delta reader may fall behind */
+
+/*
+ * A finished frame. Published by the render owner through RCU; readers take
+ * rcu_read_lock(), call vgadash_frame_get() and see one consistent frame.
+ * The generation only moves when the frame content changes.
+ */
+struct vgadash_frame {
+	struct rcu_head rcu;
+	u64 gen;
+	u64 ts_ns;
+	u8 page;
+	u16 cells[VGA_CELLS];
+	/* rows changed by generation g, at dirty[g % FRAME_DIRTY_HIST] */
+	u32 dirty[FRAME_DIRTY_HIST];
+};
+
+extern struct vgadash_frame __rcu *vgadash_cur_frame;
+
+void vgadash_frame_exit(void);
+
+/* Render owner only: publish `cells` if they differ from the current frame */
+void vgadash_frame_publish(const u16 *cells, u8 page);
+
+/* Current frame or NULL; caller holds rcu_read_lock() */
+static inline struct vgadash_frame *vgadash_frame_get(void)
+{
+	return rcu_dereference(vgadash_cur_frame);
+}
+
+u64 vgadash_frame_gen(void);
+
+/*
+ * Rows of `f` that changed after generation `base`, one bit per row. Sets
+ * *full (and returns all rows) when the history does not reach back to base.
+ */
+u32 vgadash_frame_dirty_since(const struct vgadash_frame *f, u64 base, bool *full);
+
+/* For .poll: waits for the generation to move past `seen` */
+__poll_t vgadash_frame_poll(struct file *file, poll_table *pt, u64 seen);
+
+#endif
@@ -0,0 +1,387 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Per-CPU heartbeats.
+ *
+ * Each CPU beats twice: a pinned hard-irq hrtimer stamps the time every
+ * hb_period_ms, and kicks a SCHED_FIFO kthread bound to the CPU that stamps
+ * it again when it gets to run. A stale timer beat means interrupts are off;
+ * a fresh timer beat with a stale kthread beat means the CPU does not
+ * reschedule (preemption off, or a higher priority hog). The page reads the
+ * stamps from any CPU, so a stuck CPU shows up without its cooperation.
+ *
+ * A beat that arrives after more than hb_stall_ms records how long the gap
+ * was, per CPU and in a short list of the longest stalls. The cost is two
+ * wakeups per CPU per period whatever the number of CPUs.
+ */
+#include <linux/kernel.h>
+#include <linux/cpu.h>
+#include <linux/err.h>
+#include <linux/kthread.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+#include <linux/topology.h>
+
+#include "vgadash.h"
+#include "cpu_timers.h"
+#include "heartbeat.h"
+
+#define HB_MIN_PERIOD_MS 10
+#define HB_RECENT_NS     (60 * NSEC_PER_SEC)
+
+static bool heartbeat;
+module_param(heartbeat, bool, 0444);
+MODULE_PARM_DESC(heartbeat, "Run the per-CPU heartbeats from load on, not only while the stall page is shown");
+
+static unsigned int hb_period_ms = 100;
+module_param(hb_period_ms, uint, 0644);
+MODULE_PARM_DESC(hb_period_ms, "Heartbeat period in ms (applies when the heartbeats start)");
+
+static unsigned int hb_stall_ms = 500;
+module_param(hb_stall_ms, uint, 0644);
+MODULE_PARM_DESC(hb_stall_ms, "A heartbeat missing for this long is a stall (at least two periods)");
+
+struct hb_pcpu {
+	struct hrtimer timer;
+	struct task_struct *thread;
+	int cpu;
+	bool kick;
+	bool unbound;       /* the thread lost its CPU to hotplug */
+	u64 irq_ns;         /* last timer beat */
+	u64 task_ns;        /* last kthread beat */
+	u64 irq_max_ns;
+	u64 task_max_ns;
+	u64 last_stall_ns;  /* when the last stall ended */
+	u32 irq_stalls;
+	u32 irq_stalls_seen; /* irq_stalls at the last kthread beat */
+	u32 task_stalls;
+};
+
+static DEFINE_PER_CPU(struct hb_pcpu, hb_pcpu);
+
+static enum hrtimer_restart hb_timer_fn(struct hrtimer *t);
+static void hb_cpu_online(unsigned int cpu);
+
+static struct vgadash_cpu_timers hb_timers = {
+	.timers = &hb_pcpu.timer,
+	.fn     = hb_timer_fn,
+	.online = hb_cpu_online,
+};
+
+static DEFINE_MUTEX(hb_lock);
+static int hb_users;
+static u64 hb_stall_ns;
+
+struct hb_top_ent {
+	int cpu;
+	u8 kind;
+	u64 len_ns;
+	u64 end_ns;
+};
+
+/* Longest stalls, longest first */
+static DEFINE_RAW_SPINLOCK(hb_top_lock);
+static struct hb_top_ent hb_top[HB_TOP];
+static int hb_nr_top;
+static u64 hb_total;
+
+static void hb_record(struct hb_pcpu *hc, enum hb_kind kind, u64 len, u64 now)
+{
+	unsigned long flags;
+	int i;
+
+	WRITE_ONCE(hc->last_stall_ns, now);
+
+	raw_spin_lock_irqsave(&hb_top_lock, flags);
+	hb_total++;
+	if (hb_nr_top < HB_TOP || hb_top[hb_nr_top - 1].len_ns < len) {
+		i = (hb_nr_top < HB_TOP) ? hb_nr_top++ : HB_TOP - 1;
+		for (; i > 0 && hb_top[i - 1].len_ns < len; i--)
+			hb_top[i] = hb_top[i - 1];
+		hb_top[i].cpu = hc->cpu;
+		hb_top[i].kind = kind;
+		hb_top[i].len_ns = len;
+		hb_top[i].end_ns = now;
+	}
+	raw_spin_unlock_irqrestore(&hb_top_lock, flags);
+}
+
+static enum hrtimer_restart hb_timer_fn(struct hrtimer *t)
+{
+	struct hb_pcpu *hc = container_of(t, struct hb_pcpu, timer);
+	u64 now = ktime_get_ns();
+	u64 last = hc->irq_ns;
+
+	if (last) {
+		u64 gap = now - last;
+
+		if (gap > hc->irq_max_ns)
+			WRITE_ONCE(hc->irq_max_ns, gap);
+		if (gap >= hb_stall_ns) {
+			WRITE_ONCE(hc->irq_stalls, hc->irq_stalls + 1);
+			hb_record(hc, HB_IRQ, gap, now);
+		}
+	}
+	WRITE_ONCE(hc->irq_ns, now);
+
+	if (hc->thread && !READ_ONCE(hc->kick)) {
+		WRITE_ONCE(hc->kick, true);
+		wake_up_process(hc->thread);
+	}
+
+	hrtimer_forward_now(t, hb_timers.period);
+	return HRTIMER_RESTART;
+}
+
+/*
+ * A CPU (back) online: the time it spent offline is not a stall. Its thread
+ * was moved off when it went down and is no longer bound to it, so from the
+ * first beat that runs elsewhere the CPU only gets the irq heartbeat.
+ */
+static void hb_cpu_online(unsigned int cpu)
+{
+	struct hb_pcpu *hc = per_cpu_ptr(&hb_pcpu, cpu);
+
+	WRITE_ONCE(hc->irq_ns, 0);
+	WRITE_ONCE(hc->task_ns, 0);
+	hc->irq_stalls_seen = READ_ONCE(hc->irq_stalls);
+}
+
+static void hb_task_beat(struct hb_pcpu *hc)
+{
+	u64 now = ktime_get_ns();
+	u64 last = hc->task_ns;
+	u32 irq_stalls = READ_ONCE(hc->irq_stalls);
+
+	/* The CPU went offline and the thread was moved: not its beat */
+	if (READ_ONCE(hc->unbound) || raw_smp_processor_id() != hc->cpu) {
+		WRITE_ONCE(hc->unbound, true);
+		return;
+	}
+
+	if (last) {
+		u64 gap = now - last;
+
+		if (gap > hc->task_max_ns)
+			WRITE_ONCE(hc->task_max_ns, gap);
+		/* An irq stall in between already explains the gap */
+		if (gap >= hb_stall_ns && irq_stalls == hc->irq_stalls_seen) {
+			WRITE_ONCE(hc->task_stalls, hc->task_stalls + 1);
+			hb_record(hc, HB_PREEMPT, gap, now);
+		}
+	}
+	hc->irq_stalls_seen = irq_stalls;
+	WRITE_ONCE(hc->task_ns, now);
+}
+
+static int hb_thread_fn(void *arg)
+{
+	struct hb_pcpu *hc = arg;
+
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!READ_ONCE(hc->kick) && !kthread_should_stop())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		WRITE_ONCE(hc->kick, false);
+		hb_task_beat(hc);
+	}
+	return 0;
+}
+
+static void hb_start_locked(void)
+{
+	struct task_struct *t;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct hb_pcpu *hc = per_cpu_ptr(&hb_pcpu, cpu);
+
+		memset(hc, 0, sizeof(*hc));
+		hc->cpu = cpu;
+	}
+
+	raw_spin_lock_irq(&hb_top_lock);
+	hb_nr_top = 0;
+	hb_total = 0;
+	raw_spin_unlock_irq(&hb_top_lock);
+
+	hb_timers.period = ms_to_ktime(max(hb_period_ms, (unsigned int)HB_MIN_PERIOD_MS));
+	hb_stall_ns = max_t(u64, (u64)hb_stall_ms * NSEC_PER_MSEC,
+			    2 * ktime_to_ns(hb_timers.period));
+
+	/* A CPU without its thread still gets the irq heartbeat */
+	for_each_online_cpu(cpu) {
+		struct hb_pcpu *hc = per_cpu_ptr(&hb_pcpu, cpu);
+
+		t = kthread_create_on_node(hb_thread_fn, hc, cpu_to_node(cpu),
+					   VGADASH_NAME "_hb/%d", cpu);
+		if (IS_ERR(t)) {
+			pr_warn(VGADASH_NAME ": no heartbeat thread on CPU %d: %ld\n",
+				cpu, PTR_ERR(t));
+			continue;
+		}
+		kthread_bind(t, cpu);
+		sched_set_fifo_low(t);
+		hc->thread = t;
+		wake_up_process(t);
+	}
+
+	vgadash_cpu_timers_start(&hb_timers);
+}
+
+static void hb_stop_locked(void)
+{
+	int cpu;
+
+	/* Timers first: they kick the threads */
+	vgadash_cpu_timers_cancel(&hb_timers);
+
+	for_each_possible_cpu(cpu) {
+		struct hb_pcpu *hc = per_cpu_ptr(&hb_pcpu, cpu);
+
+		if (hc->thread) {
+			kthread_stop(hc->thread);
+			hc->thread = NULL;
+		}
+	}
+}
+
+void vgadash_hb_start(void)
+{
+	mutex_lock(&hb_lock);
+	if (hb_users++ == 0)
+		hb_start_locked();
+	mutex_unlock(&hb_lock);
+}
+
+void vgadash_hb_stop(void)
+{
+	mutex_lock(&hb_lock);
+	if (hb_users && --hb_users == 0)
+		hb_stop_locked();
+	mutex_unlock(&hb_lock);
+}
+
+int vgadash_hb_init(void)
+{
+	if (heartbeat)
+		vgadash_hb_start();
+	return 0;
+}
+
+void vgadash_hb_exit(void)
+{
+	mutex_lock(&hb_lock);
+	if (hb_users)
+		hb_stop_locked();
+	hb_users = 0;
+	mutex_unlock(&hb_lock);
+}
+
+static void hb_read_cpu(int cpu, u64 now, struct hb_cpu_row *r)
+{
+	const struct hb_pcpu *hc = per_cpu_ptr(&hb_pcpu, cpu);
+	u64 irq_ns = READ_ONCE(hc->irq_ns);
+	u64 task_ns = READ_ONCE(hc->task_ns);
+	u64 last_stall = READ_ONCE(hc->last_stall_ns);
+
+	r->cpu = cpu;
+	r->has_task = hc->thread && !READ_ONCE(hc->unbound);
+	r->irq_age_ns = (irq_ns && now > irq_ns) ? now - irq_ns : 0;
+	r->task_age_ns = (task_ns && now > task_ns) ? now - task_ns : 0;
+	r->irq_max_ns = READ_ONCE(hc->irq_max_ns);
+	r->task_max_ns = READ_ONCE(hc->task_max_ns);
+	r->stalls = READ_ONCE(hc->irq_stalls) + READ_ONCE(hc->task_stalls);
+	r->recent = last_stall && now - last_stall < HB_RECENT_NS;
+
+	if (r->irq_age_ns >= hb_stall_ns)
+		r->state = HB_IRQ;
+	else if (r->has_task && r->task_age_ns >= hb_stall_ns)
+		r->state = HB_PREEMPT;
+	else
+		r->state = HB_OK;
+}
+
+int vgadash_hb_cpus(struct hb_cpu_row *out, int max, struct hb_summary *sum)
+{
+	struct hb_cpu_row r;
+	u64 now;
+	int cpu, n = 0;
+
+	memset(sum, 0, sizeof(*sum));
+
+	mutex_lock(&hb_lock);
+	sum->running = hb_users > 0;
+	sum->period_ms = ktime_to_ms(hb_timers.period);
+	sum->stall_ms = div_u64(hb_stall_ns, NSEC_PER_MSEC);
+	if (!sum->running)
+		goto out;
+
+	now = ktime_get_ns();
+	for_each_cpu(cpu, &hb_timers.armed) {
+		hb_read_cpu(cpu, now, &r);
+		sum->cpus++;
+		if (r.state == HB_IRQ)
+			sum->irq_stalled++;
+		else if (r.state == HB_PREEMPT)
+			sum->preempt_stalled++;
+		if (n < max)
+			out[n++] = r;
+	}
+	sum->stalls = READ_ONCE(hb_total);
+out:
+	mutex_unlock(&hb_lock);
+
+	return n;
+}
+
+int vgadash_hb_worst(u64 *age_ns)
+{
+	struct hb_cpu_row r;
+	u64 now, age;
+	int cpu, worst = -1;
+
+	*age_ns = 0;
+
+	mutex_lock(&hb_lock);
+	if (!hb_users)
+		goto out;
+
+	now = ktime_get_ns();
+	for_each_cpu(cpu, &hb_timers.armed) {
+		hb_read_cpu(cpu, now, &r);
+		age = max(r.irq_age_ns, r.has_task ? r.task_age_ns : 0);
+		if (worst < 0 || age > *age_ns) {
+			worst = cpu;
+			*age_ns = age;
+		}
+	}
+out:
+	mutex_unlock(&hb_lock);
+
+	return worst;
+}
+
+int vgadash_hb_top(struct hb_stall *out, int max)
+{
+	u64 now = ktime_get_ns();
+	int i, n;
+
+	raw_spin_lock_irq(&hb_top_lock);
+	n = min(hb_nr_top, max);
+	for (i = 0; i < n; i++) {
+		out[i].cpu = hb_top[i].cpu;
+		out[i].kind = hb_top[i].kind;
+		out[i].len_ns = hb_top[i].len_ns;
+		out[i].ago_ns = now > hb_top[i].end_ns ? now - hb_top[i].end_ns : 0;
+	}
+	raw_spin_unlock_irq(&hb_top_lock);
+
+	return n;
+}
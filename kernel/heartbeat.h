@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _HEARTBEAT_H_
+#define _HEARTBEAT_H_
+
+#include <linux/types.h>
+
+#define HB_TOP 8 /* longest stalls kept */
+
+enum hb_kind {
+	HB_OK,
+	HB_PREEMPT, /* timer beats, kthread does not: preemption off or RT hog */
+	HB_IRQ,     /* timer does not beat either: interrupts off */
+};
+
+struct hb_cpu_row {
+	int cpu;
+	u8 state;          /* enum hb_kind right now */
+	bool has_task;     /* the CPU has a heartbeat kthread */
+	bool recent;       /* a stall ended within the last minute */
+	u64 irq_age_ns;    /* since the last timer beat */
+	u64 task_age_ns;   /* since the last kthread beat */
+	u64 irq_max_ns;    /* longest gap between timer beats */
+	u64 task_max_ns;   /* longest gap between kthread beats */
+	u32 stalls;
+};
+
+struct hb_stall {
+	int cpu;
+	u8 kind;           /* HB_PREEMPT or HB_IRQ */
+	u64 len_ns;
+	u64 ago_ns;        /* since it ended */
+};
+
+struct hb_summary {
+	bool running;
+	u32 period_ms;
+	u32 stall_ms;
+	int cpus;
+	int irq_stalled;
+	int preempt_stalled;
+	u64 stalls;
+};
+
+int  vgadash_hb_init(void);
+void vgadash_hb_exit(void);
+
+/* Page hooks; with heartbeat=1 the beats run from load to unload anyway */
+void vgadash_hb_start(void);
+void vgadash_hb_stop(void);
+
+/* Copy rows for CPUs with a heartbeat; returns rows filled */
+int vgadash_hb_cpus(struct hb_cpu_row *out, int max, struct hb_summary *sum);
+
+/* CPU silent the longest right now, and for how long; -1 if none beats */
+int vgadash_hb_worst(u64 *age_ns);
+
+/* Copy the longest stalls seen, longest first; returns entries filled */
+int vgadash_hb_top(struct hb_stall *out, int max);
+
+#endif
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Console hotkeys.
+ *
+ * A SysRq key toggles the dashboard, and an optional keyboard notifier adds
+ * Pause (toggle) plus, while the dashboard is on, Left/Right/Tab (pages),
+ * Up/Down/PgUp/PgDn/Home/End (log scrollback) and Esc (off). Both run in
+ * interrupt context: they only queue the key and kick the render owner,
+ * which applies it and draws the next frame. Nothing here waits on
+ * userspace.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/input.h>
+#include <linux/keyboard.h>
+#include <linux/notifier.h>
+#include <linux/sysrq.h>
+
+#include "vgadash.h"
+#include "hotkeys.h"
+
+static char *sysrq_key = "x";
+module_param(sysrq_key, charp, 0444);
+MODULE_PARM_DESC(sysrq_key, "SysRq key that toggles the dashboard (empty = none)");
+
+static bool hotkeys;
+module_param(hotkeys, bool, 0444);
+MODULE_PARM_DESC(hotkeys, "Console hotkeys: Pause toggles; while on, arrows/PgUp/PgDn/Home/End/Tab/Esc navigate");
+
+static int sysrq_registered;
+
+static void vgadash_sysrq(int key)
+{
+	vgadash_input(VGADASH_KEY_TOGGLE);
+}
+
+static const struct sysrq_key_op sysrq_op = {
+	.handler     = vgadash_sysrq,
+	.help_msg    = "vgadash(toggle)",
+	.action_msg  = "Toggle vgadash",
+	.enable_mask = SYSRQ_ENABLE_DUMP,
+};
+
+/* Keys taken while the dashboard is on; -1 = not ours */
+static int map_key(unsigned int code, bool shift)
+{
+	switch (code) {
+	case KEY_ESC:      return VGADASH_KEY_OFF;
+	case KEY_LEFT:     return VGADASH_KEY_PREV_PAGE;
+	case KEY_RIGHT:    return VGADASH_KEY_NEXT_PAGE;
+	case KEY_TAB:      return shift ? VGADASH_KEY_PREV_PAGE : VGADASH_KEY_NEXT_PAGE;
+	case KEY_UP:       return VGADASH_KEY_LINE_UP;
+	case KEY_DOWN:     return VGADASH_KEY_LINE_DOWN;
+	case KEY_PAGEUP:   return VGADASH_KEY_PAGE_UP;
+	case KEY_PAGEDOWN: return VGADASH_KEY_PAGE_DOWN;
+	case KEY_HOME:     return VGADASH_KEY_TOP;
+	case KEY_END:      return VGADASH_KEY_BOTTOM;
+	}
+	return -1;
+}
+
+static int vgadash_kbd_event(struct notifier_block *nb, unsigned long code, void *data)
+{
+	struct keyboard_notifier_param *p = data;
+	int key;
+
+	if (code != KBD_KEYCODE)
+		return NOTIFY_DONE;
+
+	if (p->value == KEY_PAUSE) {
+		key = VGADASH_KEY_TOGGLE;
+	} else {
+		if (!READ_ONCE(g_vgadash.active))
+			return NOTIFY_DONE;
+		key = map_key(p->value, p->shift & (1 << KG_SHIFT));
+		if (key < 0)
+			return NOTIFY_DONE;
+	}
+
+	/* Act on press and autorepeat; swallow the release too */
+	if (p->down)
+		vgadash_input(key);
+	return NOTIFY_STOP;
+}
+
+static struct notifier_block kbd_nb = {
+	.notifier_call = vgadash_kbd_event,
+};
+
+int vgadash_hotkeys_init(void)
+{
+	int ret;
+
+	if (sysrq_key && sysrq_key[0]) {
+		ret = register_sysrq_key(sysrq_key[0], &sysrq_op);
+		if (ret)
+			pr_warn(VGADASH_NAME ": SysRq-%c is taken: %d\n", sysrq_key[0], ret);
+		else
+			sysrq_registered = sysrq_key[0];
+	}
+
+	if (hotkeys) {
+		ret = register_keyboard_notifier(&kbd_nb);
+		if (ret) {
+			pr_warn(VGADASH_NAME ": keyboard hotkeys disabled: %d\n", ret);
+			hotkeys = false;
+		}
+	}
+	return 0;
+}
+
+void vgadash_hotkeys_exit(void)
+{
+	if (hotkeys)
+		unregister_keyboard_notifier(&kbd_nb);
+	if (sysrq_registered)
+		unregister_sysrq_key(sysrq_registered, &sysrq_op);
+}
@@ -0,0 +1,8 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _VGADASH_HOTKEYS_H_
+#define _VGADASH_HOTKEYS_H_
+
+int  vgadash_hotkeys_init(void);
+void vgadash_hotkeys_exit(void);
+
+#endif
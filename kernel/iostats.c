@@ -0,0 +1,277 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Block device and network interface throughput.
+ *
+ * The sampling tick snapshots the raw kernel counters while the io page is
+ * on screen and turns deltas into per-second rates. Devices live in a fixed
+ * table; a lookup hint makes the common case (devices come back in the same
+ * order every pass) O(1) per device.
+ *
+ * Disk counters are parsed from /proc/diskstats: the block layer does not
+ * export its disk list to modules, and the file is the same part_stat data.
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/netdevice.h>
+#include <linux/rcupdate.h>
+#include <linux/sort.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+#include <net/net_namespace.h>
+
+#include "vgadash.h"
+#include "iostats.h"
+
+#define IO_BUF_SIZE (64 * 1024)
+
+enum {
+	C_RD_OPS,
+	C_WR_OPS,
+	C_RD_BYTES,
+	C_WR_BYTES,
+	C_TICKS,   /* disk: ms spent doing I/O */
+	C_DROPS,
+	IO_NR_CTRS,
+};
+
+struct io_dev {
+	bool used;
+	bool seen;
+	bool have_prev;
+	struct io_row row;
+	u64 prev[IO_NR_CTRS];
+};
+
+static DEFINE_MUTEX(io_lock);
+static struct io_dev io_table[IO_MAX_DEVS];
+static u16 io_order[IO_MAX_DEVS];
+static int io_hint;
+static char *io_buf;
+static u64 io_last_ns;
+static bool io_running;
+
+static struct io_dev *io_find(enum io_kind kind, const char *name)
+{
+	struct io_dev *d;
+	int i, free = -1;
+
+	for (i = 0; i < IO_MAX_DEVS; i++) {
+		int idx = (io_hint + i) % IO_MAX_DEVS;
+
+		d = &io_table[idx];
+		if (!d->used) {
+			if (free < 0)
+				free = idx;
+			continue;
+		}
+		if (d->row.kind == kind && !strcmp(d->row.name, name)) {
+			io_hint = idx + 1;
+			return d;
+		}
+	}
+
+	/* Table full: the device is simply not shown */
+	if (free < 0)
+		return NULL;
+
+	d = &io_table[free];
+	memset(d, 0, sizeof(*d));
+	d->used = true;
+	d->row.kind = kind;
+	strscpy(d->row.name, name, sizeof(d->row.name));
+	io_hint = free + 1;
+	return d;
+}
+
+static inline u64 io_rate(u64 delta, u64 dt_ns)
+{
+	return div64_u64(delta * NSEC_PER_SEC, dt_ns);
+}
+
+static void io_update(struct io_dev *d, const u64 *cur, u64 dt_ns)
+{
+	struct io_row *r = &d->row;
+
+	if (d->have_prev && dt_ns) {
+		u64 busy_ms = cur[C_TICKS] - d->prev[C_TICKS];
+
+		r->rd_ops   = io_rate(cur[C_RD_OPS] - d->prev[C_RD_OPS], dt_ns);
+		r->wr_ops   = io_rate(cur[C_WR_OPS] - d->prev[C_WR_OPS], dt_ns);
+		r->rd_bytes = io_rate(cur[C_RD_BYTES] - d->prev[C_RD_BYTES], dt_ns);
+		r->wr_bytes = io_rate(cur[C_WR_BYTES] - d->prev[C_WR_BYTES], dt_ns);
+		r->drops    = io_rate(cur[C_DROPS] - d->prev[C_DROPS], dt_ns);
+		r->busy_pct = min_t(u64, 100,
+				    div64_u64(busy_ms * NSEC_PER_MSEC * 100, dt_ns));
+	}
+
+	memcpy(d->prev, cur, sizeof(d->prev));
+	d->have_prev = true;
+	d->seen = true;
+}
+
+static void io_sample_disks(u64 dt_ns)
+{
+	struct file *f;
+	loff_t pos = 0;
+	size_t len = 0;
+	ssize_t n;
+	char *line, *next;
+
+	f = filp_open("/proc/diskstats", O_RDONLY, 0);
+	if (IS_ERR(f))
+		return;
+
+	while (len < IO_BUF_SIZE - 1) {
+		n = kernel_read(f, io_buf + len, IO_BUF_SIZE - 1 - len, &pos);
+		if (n <= 0)
+			break;
+		len += n;
+	}
+	filp_close(f, NULL);
+	io_buf[len] = '\0';
+
+	for (line = io_buf; line && *line; line = next) {
+		unsigned long long rd, rd_sec, wr, wr_sec, inflight, ticks;
+		char name[IO_NAME_LEN];
+		u64 cur[IO_NR_CTRS];
+		struct io_dev *d;
+
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+
+		/* major minor name rd rd_merged rd_sec rd_ms wr wr_merged wr_sec wr_ms inflight io_ms */
+		if (sscanf(line, " %*u %*u %31s %llu %*u %llu %*u %llu %*u %llu %*u %llu %llu",
+			   name, &rd, &rd_sec, &wr, &wr_sec, &inflight, &ticks) != 7)
+			continue;
+
+		d = io_find(IO_DISK, name);
+		if (!d)
+			continue;
+
+		cur[C_RD_OPS]   = rd;
+		cur[C_WR_OPS]   = wr;
+		cur[C_RD_BYTES] = rd_sec * 512;
+		cur[C_WR_BYTES] = wr_sec * 512;
+		cur[C_TICKS]    = ticks;
+		cur[C_DROPS]    = 0;
+		io_update(d, cur, dt_ns);
+		d->row.inflight = inflight;
+	}
+}
+
+static void io_sample_netdevs(u64 dt_ns)
+{
+	struct net_device *dev;
+
+	rcu_read_lock();
+	for_each_netdev_rcu(&init_net, dev) {
+		struct rtnl_link_stats64 st;
+		u64 cur[IO_NR_CTRS];
+		struct io_dev *d;
+
+		d = io_find(IO_NET, dev->name);
+		if (!d)
+			continue;
+
+		dev_get_stats(dev, &st);
+		cur[C_RD_OPS]   = st.rx_packets;
+		cur[C_WR_OPS]   = st.tx_packets;
+		cur[C_RD_BYTES] = st.rx_bytes;
+		cur[C_WR_BYTES] = st.tx_bytes;
+		cur[C_TICKS]    = 0;
+		cur[C_DROPS]    = st.rx_dropped + st.tx_dropped;
+		io_update(d, cur, dt_ns);
+	}
+	rcu_read_unlock();
+}
+
+static void io_sample(void)
+{
+	u64 now = ktime_get_ns();
+	u64 dt = io_last_ns ? now - io_last_ns : 0;
+	int i;
+
+	for (i = 0; i < IO_MAX_DEVS; i++)
+		io_table[i].seen = false;
+
+	io_sample_disks(dt);
+	io_sample_netdevs(dt);
+
+	/* Forget devices that went away */
+	for (i = 0; i < IO_MAX_DEVS; i++) {
+		if (io_table[i].used && !io_table[i].seen)
+			io_table[i].used = false;
+	}
+
+	io_last_ns = now;
+}
+
+void vgadash_io_tick(void)
+{
+	mutex_lock(&io_lock);
+	if (io_running)
+		io_sample();
+	mutex_unlock(&io_lock);
+}
+
+void vgadash_io_start(void)
+{
+	mutex_lock(&io_lock);
+	if (!io_running) {
+		io_buf = kvmalloc(IO_BUF_SIZE, GFP_KERNEL);
+		if (io_buf) {
+			memset(io_table, 0, sizeof(io_table));
+			io_last_ns = 0;
+			io_running = true;
+		}
+	}
+	mutex_unlock(&io_lock);
+}
+
+void vgadash_io_stop(void)
+{
+	mutex_lock(&io_lock);
+	io_running = false;
+	kvfree(io_buf);
+	io_buf = NULL;
+	mutex_unlock(&io_lock);
+}
+
+static u64 io_score(const struct io_row *r)
+{
+	return (u64)r->rd_ops + r->wr_ops;
+}
+
+static int io_cmp(const void *a, const void *b)
+{
+	u64 sa = io_score(&io_table[*(const u16 *)a].row);
+	u64 sb = io_score(&io_table[*(const u16 *)b].row);
+
+	if (sa == sb)
+		return 0;
+	return (sa > sb) ? -1 : 1;
+}
+
+int vgadash_io_top(enum io_kind kind, struct io_row *out, int max)
+{
+	int i, n = 0;
+
+	mutex_lock(&io_lock);
+	for (i = 0; i < IO_MAX_DEVS; i++) {
+		if (io_table[i].used && io_table[i].row.kind == kind)
+			io_order[n++] = i;
+	}
+
+	sort(io_order, n, sizeof(io_order[0]), io_cmp, NULL);
+
+	n = min(n, max);
+	for (i = 0; i < n; i++)
+		out[i] = io_table[io_order[i]].row;
+	mutex_unlock(&io_lock);
+
+	return n;
+}
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _IOSTATS_H_
+#define _IOSTATS_H_
+
+#include <linux/types.h>
+
+#define IO_MAX_DEVS  256
+#define IO_NAME_LEN  32
+
+enum io_kind {
+	IO_DISK = 0,
+	IO_NET  = 1,
+};
+
+/* Per-second rates from the last two snapshots of one device */
+struct io_row {
+	char name[IO_NAME_LEN];
+	u8 kind;
+	u32 rd_ops;     /* disk: read IOPS     net: rx packets/s */
+	u32 wr_ops;     /* disk: write IOPS    net: tx packets/s */
+	u64 rd_bytes;   /* disk: read B/s      net: rx B/s */
+	u64 wr_bytes;   /* disk: write B/s     net: tx B/s */
+	u32 inflight;   /* disk: requests in flight (gauge) */
+	u32 busy_pct;   /* disk: io_ticks share of the interval */
+	u32 drops;      /* net: rx + tx drops/s */
+};
+
+void vgadash_io_start(void);
+void vgadash_io_stop(void);
+
+/* Called from the sampling tick; no-op unless the io page started sampling */
+void vgadash_io_tick(void);
+
+/* Copy up to `max` devices of `kind`, busiest first; returns rows filled */
+int vgadash_io_top(enum io_kind kind, struct io_row *out, int max);
+
+#endif
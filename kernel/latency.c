@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Timer wakeup latency per CPU.
+ *
+ * A pinned hard-irq hrtimer fires every lat_period_us on each CPU and
+ * records how late it ran into a per-CPU log2 histogram. The callback's own
+ * run time is accumulated so the page can show what the measurement costs.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+
+#include "cpu_timers.h"
+#include "latency.h"
+
+#define LAT_MIN_PERIOD_US 50
+
+static unsigned int lat_period_us = 1000;
+module_param(lat_period_us, uint, 0644);
+MODULE_PARM_DESC(lat_period_us, "Latency probe timer period in us (applies when the lat page is entered)");
+
+struct lat_pcpu {
+	struct hrtimer timer;
+	u64 hist[LAT_BUCKETS];
+	u64 cur_ns;
+	u64 max_ns;
+	u64 cb_ns;
+};
+
+static DEFINE_PER_CPU(struct lat_pcpu, lat_pcpu);
+
+static enum hrtimer_restart lat_timer_fn(struct hrtimer *t);
+
+static struct vgadash_cpu_timers lat_timers = {
+	.timers = &lat_pcpu.timer,
+	.fn     = lat_timer_fn,
+};
+
+static DEFINE_MUTEX(lat_lock);
+static bool lat_running;
+static u64 lat_started_ns;
+
+static inline int lat_bucket(s64 ns)
+{
+	if (ns <= 0)
+		return 0;
+	return min_t(int, ilog2((u64)ns) + 1, LAT_BUCKETS - 1);
+}
+
+static enum hrtimer_restart lat_timer_fn(struct hrtimer *t)
+{
+	struct lat_pcpu *lc = container_of(t, struct lat_pcpu, timer);
+	ktime_t now = ktime_get();
+	s64 lat = ktime_to_ns(ktime_sub(now, hrtimer_get_expires(t)));
+
+	lc->hist[lat_bucket(lat)]++;
+	WRITE_ONCE(lc->cur_ns, lat > 0 ? lat : 0);
+	if (lat > 0 && lat > lc->max_ns)
+		WRITE_ONCE(lc->max_ns, lat);
+
+	hrtimer_forward(t, now, lat_timers.period);
+
+	lc->cb_ns += ktime_to_ns(ktime_sub(ktime_get(), now));
+	return HRTIMER_RESTART;
+}
+
+void vgadash_lat_start(void)
+{
+	int cpu;
+
+	mutex_lock(&lat_lock);
+	if (!lat_running) {
+		for_each_possible_cpu(cpu) {
+			struct lat_pcpu *lc = per_cpu_ptr(&lat_pcpu, cpu);
+
+			memset(lc->hist, 0, sizeof(lc->hist));
+			lc->cur_ns = 0;
+			lc->max_ns = 0;
+			lc->cb_ns = 0;
+		}
+
+		lat_timers.period = us_to_ktime(max_t(unsigned int, lat_period_us, LAT_MIN_PERIOD_US));
+		lat_started_ns = ktime_get_ns();
+		vgadash_cpu_timers_start(&lat_timers);
+		lat_running = true;
+	}
+	mutex_unlock(&lat_lock);
+}
+
+void vgadash_lat_stop(void)
+{
+	mutex_lock(&lat_lock);
+	if (lat_running) {
+		vgadash_cpu_timers_cancel(&lat_timers);
+		lat_running = false;
+	}
+	mutex_unlock(&lat_lock);
+}
+
+/* Upper bound of the bucket holding the 99th percentile */
+static u64 lat_p99(const u64 *hist, u64 samples)
+{
+	u64 want, acc = 0;
+	int b;
+
+	if (!samples)
+		return 0;
+
+	want = samples - div_u64(samples, 100);
+	for (b = 0; b < LAT_BUCKETS; b++) {
+		acc += hist[b];
+		if (acc >= want)
+			break;
+	}
+	return 1ULL << min(b, LAT_BUCKETS - 1);
+}
+
+static void lat_read_cpu(int cpu, u64 *hist, struct lat_cpu_row *r)
+{
+	const struct lat_pcpu *lc = per_cpu_ptr(&lat_pcpu, cpu);
+	u64 samples = 0;
+	int b;
+
+	for (b = 0; b < LAT_BUCKETS; b++) {
+		hist[b] = READ_ONCE(lc->hist[b]);
+		samples += hist[b];
+	}
+
+	r->cpu = cpu;
+	r->cur_ns = READ_ONCE(lc->cur_ns);
+	r->max_ns = READ_ONCE(lc->max_ns);
+	r->samples = samples;
+	r->p99_ns = lat_p99(hist, samples);
+}
+
+void vgadash_lat_summary(struct lat_summary *out)
+{
+	u64 hist[LAT_BUCKETS], all[LAT_BUCKETS] = { 0 };
+	u64 cb_ns = 0, elapsed;
+	struct lat_cpu_row r;
+	int cpu, b, ncpu = 0;
+
+	memset(out, 0, sizeof(*out));
+
+	mutex_lock(&lat_lock);
+	out->running = lat_running;
+	out->period_us = ktime_to_us(lat_timers.period);
+	if (!lat_running)
+		goto out;
+
+	for_each_cpu(cpu, &lat_timers.armed) {
+		lat_read_cpu(cpu, hist, &r);
+		for (b = 0; b < LAT_BUCKETS; b++)
+			all[b] += hist[b];
+		out->samples += r.samples;
+		out->max_ns = max(out->max_ns, r.max_ns);
+		cb_ns += READ_ONCE(per_cpu_ptr(&lat_pcpu, cpu)->cb_ns);
+		ncpu++;
+	}
+	out->p99_ns = lat_p99(all, out->samples);
+
+	elapsed = ktime_get_ns() - lat_started_ns;
+	if (elapsed && ncpu)
+		out->overhead_ppm = div64_u64(cb_ns * 1000000ULL, elapsed * ncpu);
+out:
+	mutex_unlock(&lat_lock);
+}
+
+int vgadash_lat_cpus(struct lat_cpu_row *out, int max)
+{
+	u64 hist[LAT_BUCKETS];
+	int cpu, n = 0;
+
+	mutex_lock(&lat_lock);
+	if (lat_running) {
+		for_each_cpu(cpu, &lat_timers.armed) {
+			if (n >= max)
+				break;
+			lat_read_cpu(cpu, hist, &out[n++]);
+		}
+	}
+	mutex_unlock(&lat_lock);
+
+	return n;
+}
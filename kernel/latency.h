@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include <linux/types.h>
+
+#define LAT_BUCKETS 32 /* bucket b holds latencies in [2^(b-1), 2^b) ns */
+
+struct lat_cpu_row {
+	int cpu;
+	u64 cur_ns;
+	u64 max_ns;
+	u64 p99_ns;   /* upper bound of the p99 bucket */
+	u64 samples;
+};
+
+struct lat_summary {
+	bool running;
+	u32 period_us;
+	u64 samples;
+	u64 max_ns;
+	u64 p99_ns;
+	u32 overhead_ppm; /* timer callback time / (elapsed * CPUs), parts per million */
+};
+
+void vgadash_lat_start(void);
+void vgadash_lat_stop(void);
+
+void vgadash_lat_summary(struct lat_summary *out);
+
+/* Copy per-CPU rows for armed CPUs; returns rows filled */
+int vgadash_lat_cpus(struct lat_cpu_row *out, int max);
+
+#endif
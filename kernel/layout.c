@@ -0,0 +1,235 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Tiled layouts.
+ *
+ * A layout splits the rows below the header into horizontal tiles, each
+ * showing the top of one page under a title row. Every tile keeps the rows
+ * it last rendered; a frame re-renders only the tiles whose interval ran
+ * out or that were marked dirty (layout change, page setting changed) and
+ * copies the rest from their cache. Backends then only see the cells of the
+ * tiles that actually moved.
+ *
+ * Pages are unaware of tiles: they draw into a full-size scratch canvas
+ * with g_vgadash.rows lowered to the tile height, and the tile copies rows
+ * 2.. of it.
+ */
+#include <linux/kernel.h>
+#include <linux/bitops.h>
+#include <linux/jiffies.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+
+#include "vgadash.h"
+#include "vga_text.h"
+#include "pages.h"
+#include "layout.h"
+
+#define PAGE_BODY_ROW 2 /* first row a page draws below the header */
+
+struct layout_tile {
+	u8 page;
+	u8 y;              /* title row on screen */
+	u8 rows;           /* page rows below the title */
+	u32 interval_ms;
+	unsigned long due; /* jiffies */
+	bool dirty;
+	u64 renders;
+	u16 cells[(LAYOUT_SCREEN_ROWS - 1) * VGA_COLS];
+};
+
+static struct layout_tile tiles[LAYOUT_MAX_TILES];
+static int nr_tiles;
+static u16 scratch[VGA_CELLS];
+
+int vgadash_layout_parse(char *spec, struct layout_spec *ls)
+{
+	int used = 0, flex = 0, left, i;
+	char *tok;
+
+	ls->n = 0;
+	spec = strim(spec);
+	if (!*spec || !strcmp(spec, "none"))
+		return 0;
+
+	while ((tok = strsep(&spec, " ,\t\n")) != NULL) {
+		char *rows, *ms;
+		int p;
+
+		if (!*tok)
+			continue;
+		if (ls->n == LAYOUT_MAX_TILES)
+			return -E2BIG;
+
+		ms = strchr(tok, '@');
+		if (ms)
+			*ms++ = '\0';
+		rows = strchr(tok, ':');
+		if (rows)
+			*rows++ = '\0';
+
+		p = vgadash_page_by_name(tok);
+		if (p < 0)
+			return p;
+
+		ls->tiles[ls->n].page = p;
+		ls->tiles[ls->n].rows = 0;
+		ls->tiles[ls->n].interval_ms = 0;
+		if (rows && (kstrtou8(rows, 10, &ls->tiles[ls->n].rows) || !ls->tiles[ls->n].rows))
+			return -EINVAL;
+		if (ms && kstrtou32(ms, 10, &ls->tiles[ls->n].interval_ms))
+			return -EINVAL;
+
+		used += 1 + ls->tiles[ls->n].rows;
+		if (!ls->tiles[ls->n].rows)
+			flex++;
+		ls->n++;
+	}
+
+	/* Tiles without a height share what is left, at least one row each */
+	left = LAYOUT_SCREEN_ROWS - used;
+	if (left < flex)
+		return -ENOSPC;
+	for (i = 0; i < ls->n && flex; i++) {
+		if (ls->tiles[i].rows)
+			continue;
+		ls->tiles[i].rows = left / flex;
+		left -= ls->tiles[i].rows;
+		flex--;
+	}
+	return 0;
+}
+
+void vgadash_layout_apply(const struct layout_spec *ls)
+{
+	int i, y = LAYOUT_FIRST_ROW;
+
+	for (i = 0; i < ls->n; i++) {
+		struct layout_tile *t = &tiles[i];
+
+		t->page = ls->tiles[i].page;
+		t->rows = ls->tiles[i].rows;
+		t->interval_ms = ls->tiles[i].interval_ms;
+		t->y = y;
+		t->dirty = true;
+		t->renders = 0;
+		y += 1 + t->rows;
+	}
+	nr_tiles = ls->n;
+}
+
+bool vgadash_layout_active(void)
+{
+	return nr_tiles > 0;
+}
+
+unsigned long vgadash_layout_pages(void)
+{
+	unsigned long mask = 0;
+	int i;
+
+	for (i = 0; i < nr_tiles; i++)
+		__set_bit(tiles[i].page, &mask);
+	return mask;
+}
+
+void vgadash_layout_touch(int page)
+{
+	int i;
+
+	for (i = 0; i < nr_tiles; i++) {
+		if (page < 0 || tiles[i].page == page)
+			tiles[i].dirty = true;
+	}
+}
+
+static void render_tile(struct layout_tile *t)
+{
+	u16 *canvas = g_vgadash.canvas;
+
+	vga_frame_clear(scratch, 0x07, VGA_CELLS);
+	g_vgadash.canvas = scratch;
+	g_vgadash.rows = PAGE_BODY_ROW + t->rows;
+
+	vgadash_pages[t->page].render_vga();
+
+	g_vgadash.canvas = canvas;
+	g_vgadash.rows = VGA_ROWS;
+
+	memcpy(t->cells, scratch + PAGE_BODY_ROW * VGA_COLS,
+	       t->rows * VGA_COLS * sizeof(u16));
+	t->renders++;
+}
+
+/* "-[ logs ]------ ... ---[ 250ms ]-" */
+static void draw_title(u16 *canvas, const struct layout_tile *t)
+{
+	char buf[VGA_COLS + 1], tag[24];
+	int n;
+
+	memset(buf, '-', VGA_COLS);
+	buf[VGA_COLS] = '\0';
+
+	n = scnprintf(tag, sizeof(tag), "[ %s ]", vgadash_page_name(t->page));
+	memcpy(buf + 1, tag, n);
+
+	if (t->interval_ms) {
+		n = scnprintf(tag, sizeof(tag), "[ %ums ]", t->interval_ms);
+		memcpy(buf + VGA_COLS - 1 - n, tag, n);
+	}
+
+	vga_frame_puts_at(canvas, 0, t->y, buf, 0x08);
+}
+
+unsigned long vgadash_layout_render(u16 *canvas, unsigned int default_ms)
+{
+	unsigned long now = jiffies, next = MAX_JIFFY_OFFSET;
+	int i;
+
+	for (i = 0; i < nr_tiles; i++) {
+		struct layout_tile *t = &tiles[i];
+		unsigned int ms = t->interval_ms ? t->interval_ms : default_ms;
+
+		if (t->dirty || (ms && time_after_eq(now, t->due))) {
+			render_tile(t);
+			t->dirty = false;
+			t->due = now + msecs_to_jiffies(ms);
+		}
+		if (ms)
+			next = min(next, t->due - now);
+
+		draw_title(canvas, t);
+		memcpy(canvas + (t->y + 1) * VGA_COLS, t->cells,
+		       t->rows * VGA_COLS * sizeof(u16));
+	}
+	return next;
+}
+
+int vgadash_layout_names(char *buf, size_t cap)
+{
+	int i, n = 0;
+
+	for (i = 0; i < nr_tiles; i++)
+		n += scnprintf(buf + n, cap - n, "%s%s", i ? "+" : "",
+			       vgadash_page_name(tiles[i].page));
+	return n;
+}
+
+void vgadash_layout_seq_show(struct seq_file *m)
+{
+	int i;
+
+	if (!nr_tiles) {
+		seq_puts(m, "none\n");
+		return;
+	}
+
+	for (i = 0; i < nr_tiles; i++)
+		seq_printf(m, "%s%s:%u@%u", i ? " " : "",
+			   vgadash_page_name(tiles[i].page), tiles[i].rows, tiles[i].interval_ms);
+	seq_putc(m, '\n');
+
+	for (i = 0; i < nr_tiles; i++)
+		seq_printf(m, "tile %d page=%s rows=%u-%u interval_ms=%u renders=%llu\n",
+			   i, vgadash_page_name(tiles[i].page), tiles[i].y + 1,
+			   tiles[i].y + tiles[i].rows, tiles[i].interval_ms, tiles[i].renders);
+}
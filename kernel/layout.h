@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LAYOUT_H_
+#define _LAYOUT_H_
+
+#include <linux/types.h>
+#include <linux/seq_file.h>
+
+#include "vgadash.h"
+
+#define LAYOUT_MAX_TILES   4
+#define LAYOUT_FIRST_ROW   1                        /* below the header */
+#define LAYOUT_SCREEN_ROWS (VGA_ROWS - LAYOUT_FIRST_ROW) /* titles included */
+
+/* A parsed layout; a tile is a title row followed by `rows` page rows */
+struct layout_spec {
+	int n;
+	struct {
+		u8 page;
+		u8 rows;
+		u32 interval_ms; /* 0: refresh_ms */
+	} tiles[LAYOUT_MAX_TILES];
+};
+
+/* Parse "<page>[:<rows>][@<ms>] ..."; modifies `spec`. n == 0 means no tiles */
+int vgadash_layout_parse(char *spec, struct layout_spec *ls);
+
+/*
+ * The rest run under the render lock.
+ */
+
+/* Replace the current layout; all tiles start dirty */
+void vgadash_layout_apply(const struct layout_spec *ls);
+
+bool vgadash_layout_active(void);
+
+/* Bitmap of pages shown by the layout, for enter/leave hooks */
+unsigned long vgadash_layout_pages(void);
+
+/* Re-render tiles showing `page` (or all tiles for -1) on the next frame */
+void vgadash_layout_touch(int page);
+
+/*
+ * Render the tiles that are due or dirty into their caches and compose all
+ * tiles onto `canvas`. Tiles without an interval use `default_ms` (0: only
+ * when dirty). Returns the jiffies until the next tile is due, or
+ * MAX_JIFFY_OFFSET if none is.
+ */
+unsigned long vgadash_layout_render(u16 *canvas, unsigned int default_ms);
+
+/* "+"-joined page names for the header */
+int vgadash_layout_names(char *buf, size_t cap);
+
+void vgadash_layout_seq_show(struct seq_file *m);
+
+#endif
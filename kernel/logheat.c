@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Heavy-hitter accounting for console records.
+ *
+ * Every record is keyed on (tag, level), where the tag is the first word of
+ * the message (driver/subsystem prefix). Per-key counts for the current second
+ * go into a count-min sketch; keys whose estimate beats the weakest tracked
+ * entry are admitted into a small top-K table that keeps per-second slots for
+ * the sliding windows. Memory is fixed and each record costs O(DEPTH + K).
+ */
+#include <linux/kernel.h>
+#include <linux/ctype.h>
+#include <linux/jhash.h>
+#include <linux/math64.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+
+#include "logheat.h"
+
+#define CMS_DEPTH 4
+#define CMS_WIDTH 256 /* power of two */
+
+/* One extra slot holds the second currently being filled */
+#define HEAT_SLOTS (LOGHEAT_WINDOW + 1)
+
+struct heat_key {
+	char tag[LOGHEAT_TAG_LEN];
+	u8 level;
+};
+
+struct heat_slot {
+	u32 sec;
+	u32 lines;
+	u32 bytes;
+};
+
+struct heat_entry {
+	bool used;
+	u32 hash;
+	struct heat_key key;
+	struct heat_slot slots[HEAT_SLOTS];
+};
+
+static DEFINE_SPINLOCK(heat_lock);
+
+/* Sketch counts cover the current second only; cleared on rollover */
+static u32 cms_lines[CMS_DEPTH][CMS_WIDTH];
+static u32 cms_bytes[CMS_DEPTH][CMS_WIDTH];
+static u32 cms_sec;
+
+static struct heat_entry topk[LOGHEAT_TOPK];
+
+static inline u32 heat_now_sec(void)
+{
+	return (u32)div_u64(ktime_get_mono_fast_ns(), NSEC_PER_SEC);
+}
+
+/* Pull "<N>", "[ timestamp]" and the first word out of a console record */
+static void heat_parse_key(u8 level, const char *s, unsigned int n, struct heat_key *k)
+{
+	unsigned int i = 0, t = 0;
+
+	memset(k, 0, sizeof(*k));
+	k->level = level;
+
+	/* Plain (non-extended) records may still carry a "<N>" prefix */
+	if (level == LOGHEAT_LEVEL_NONE && n >= 3 && s[0] == '<') {
+		unsigned int j = 1, v = 0;
+
+		while (j < n && j < 5 && isdigit(s[j]))
+			v = v * 10 + (s[j++] - '0');
+		if (j > 1 && j < n && s[j] == '>') {
+			k->level = v & 7;
+			i = j + 1;
+		}
+	}
+
+	if (i < n && s[i] == '[') {
+		unsigned int j = i + 1;
+
+		while (j < n && j < i + 24 && s[j] != ']')
+			j++;
+		if (j < n && s[j] == ']')
+			i = j + 1;
+	}
+
+	while (i < n && s[i] == ' ')
+		i++;
+
+	while (i < n && t < LOGHEAT_TAG_LEN - 1) {
+		char c = s[i++];
+
+		if (c == ':' || c == ' ' || c == '[' || c == '(' || !isprint(c))
+			break;
+		k->tag[t++] = c;
+	}
+
+	if (!t)
+		k->tag[0] = '-';
+}
+
+static inline struct heat_slot *heat_slot(struct heat_entry *e, u32 sec)
+{
+	struct heat_slot *sl = &e->slots[sec % HEAT_SLOTS];
+
+	if (sl->sec != sec) {
+		sl->sec = sec;
+		sl->lines = 0;
+		sl->bytes = 0;
+	}
+	return sl;
+}
+
+static u32 heat_window_lines(const struct heat_entry *e, u32 now)
+{
+	u32 sum = 0;
+	int i;
+
+	for (i = 0; i < HEAT_SLOTS; i++) {
+		if (now - e->slots[i].sec <= LOGHEAT_WINDOW)
+			sum += e->slots[i].lines;
+	}
+	return sum;
+}
+
+/* Bump the sketch for this key and return its (lines, bytes) estimates */
+static void cms_add(u32 h1, u32 h2, unsigned int n, u32 *est_lines, u32 *est_bytes)
+{
+	u32 ml = U32_MAX, mb = U32_MAX;
+	int d;
+
+	for (d = 0; d < CMS_DEPTH; d++) {
+		u32 idx = (h1 + d * h2) & (CMS_WIDTH - 1);
+
+		cms_lines[d][idx]++;
+		cms_bytes[d][idx] += n;
+		ml = min(ml, cms_lines[d][idx]);
+		mb = min(mb, cms_bytes[d][idx]);
+	}
+
+	*est_lines = ml;
+	*est_bytes = mb;
+}
+
+void vgadash_logheat_account(u8 level, const char *s, unsigned int n)
+{
+	struct heat_entry *e = NULL, *victim = NULL;
+	struct heat_slot *sl;
+	struct heat_key key;
+	unsigned long flags;
+	u32 h1, h2, now, est_lines, est_bytes, vscore = U32_MAX;
+	int i;
+
+	if (!n)
+		return;
+
+	heat_parse_key(level, s, n, &key);
+	h1 = jhash(&key, sizeof(key), 0);
+	h2 = jhash(&key, sizeof(key), h1) | 1;
+	now = heat_now_sec();
+
+	spin_lock_irqsave(&heat_lock, flags);
+
+	/* Once-per-second reset; amortised over every record in that second */
+	if (now != cms_sec) {
+		memset(cms_lines, 0, sizeof(cms_lines));
+		memset(cms_bytes, 0, sizeof(cms_bytes));
+		cms_sec = now;
+	}
+	cms_add(h1, h2, n, &est_lines, &est_bytes);
+
+	for (i = 0; i < LOGHEAT_TOPK; i++) {
+		struct heat_entry *t = &topk[i];
+		u32 score;
+
+		if (!t->used) {
+			if (!victim || vscore) {
+				victim = t;
+				vscore = 0;
+			}
+			continue;
+		}
+		if (t->hash == h1 && !memcmp(&t->key, &key, sizeof(key))) {
+			e = t;
+			break;
+		}
+		score = heat_window_lines(t, now);
+		if (score < vscore) {
+			victim = t;
+			vscore = score;
+		}
+	}
+
+	if (e) {
+		sl = heat_slot(e, now);
+		sl->lines++;
+		sl->bytes += n;
+	} else if (victim && (!victim->used ||
+			      est_lines > DIV_ROUND_UP(vscore, LOGHEAT_WINDOW))) {
+		/*
+		 * Space-saving style takeover: inherit the sketch estimate. The
+		 * sketch counts this second, so it has to beat the victim's
+		 * average second over the window it was chosen by, not its
+		 * current second, which is empty right after every boundary.
+		 */
+		memset(victim, 0, sizeof(*victim));
+		victim->used = true;
+		victim->hash = h1;
+		victim->key = key;
+		sl = heat_slot(victim, now);
+		sl->lines = est_lines;
+		sl->bytes = est_bytes;
+	}
+
+	spin_unlock_irqrestore(&heat_lock, flags);
+}
+
+int vgadash_logheat_top(struct logheat_row *out, int max)
+{
+	struct logheat_row rows[LOGHEAT_TOPK];
+	unsigned long flags;
+	u32 now = heat_now_sec();
+	int i, j, cnt = 0;
+
+	/* All of them: the table is in slot order, the hottest may come last */
+	spin_lock_irqsave(&heat_lock, flags);
+	for (i = 0; i < LOGHEAT_TOPK; i++) {
+		const struct heat_entry *e = &topk[i];
+		struct logheat_row *r = &rows[cnt];
+
+		if (!e->used)
+			continue;
+
+		memset(r, 0, sizeof(*r));
+		memcpy(r->tag, e->key.tag, LOGHEAT_TAG_LEN);
+		r->level = e->key.level;
+
+		for (j = 0; j < HEAT_SLOTS; j++) {
+			const struct heat_slot *sl = &e->slots[j];
+			u32 age = now - sl->sec;
+
+			if (age == 0 || age > LOGHEAT_WINDOW)
+				continue;
+			if (age == 1) {
+				r->lines_1s = sl->lines;
+				r->bytes_1s = sl->bytes;
+			}
+			r->lines_win += sl->lines;
+			r->bytes_win += sl->bytes;
+		}
+		cnt++;
+	}
+	spin_unlock_irqrestore(&heat_lock, flags);
+
+	/* K is tiny: insertion sort by windowed line count */
+	for (i = 1; i < cnt; i++) {
+		struct logheat_row tmp = rows[i];
+
+		for (j = i - 1; j >= 0 && rows[j].lines_win < tmp.lines_win; j--)
+			rows[j + 1] = rows[j];
+		rows[j + 1] = tmp;
+	}
+
+	cnt = clamp(cnt, 0, max);
+	memcpy(out, rows, cnt * sizeof(*out));
+	return cnt;
+}
+
+void vgadash_logheat_init(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&heat_lock, flags);
+	memset(cms_lines, 0, sizeof(cms_lines));
+	memset(cms_bytes, 0, sizeof(cms_bytes));
+	memset(topk, 0, sizeof(topk));
+	cms_sec = heat_now_sec();
+	spin_unlock_irqrestore(&heat_lock, flags);
+}
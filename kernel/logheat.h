@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LOGHEAT_H_
+#define _LOGHEAT_H_
+
+#include <linux/types.h>
+
+#define LOGHEAT_TOPK    16
+#define LOGHEAT_TAG_LEN 16
+#define LOGHEAT_WINDOW  10 /* seconds in the long sliding window */
+
+#define LOGHEAT_LEVEL_NONE 0xFF /* record carried no level */
+
+struct logheat_row {
+	char tag[LOGHEAT_TAG_LEN];
+	u8 level;
+	u32 lines_1s;   /* last complete second */
+	u32 bytes_1s;
+	u32 lines_win;  /* sum over the last LOGHEAT_WINDOW complete seconds */
+	u32 bytes_win;
+};
+
+void vgadash_logheat_init(void);
+
+/* Account one console record of `level` (or LOGHEAT_LEVEL_NONE); O(1), safe from any context */
+void vgadash_logheat_account(u8 level, const char *s, unsigned int n);
+
+/* Copy the tracked emitters sorted by lines_win (desc); returns rows filled */
+int vgadash_logheat_top(struct logheat_row *out, int max);
+
+#endif
@@ -1,66 +1,1017 @@
 // SPDX-License-Identifier: GPL-2.0
+/*
+ * Console tap.
+ *
+ * The console is registered as CON_EXTENDED so every write carries the
+ * record's level, sequence number and timestamp ("lvl,seq,ts,flags;msg").
+ * Records are stored by severity class in separate byte rings, each record
+ * being a fixed header followed by the message text. Headers carry the size
+ * of the previous record, so readers can walk a ring backwards from the
+ * newest record and merge the classes by sequence number.
+ *
+ * Every LT_CKPT_EVERY records a ring also notes (seq, ts, offset) in a small
+ * checkpoint array, dropped again when the record is evicted. Seeking to a
+ * sequence number or timestamp is a binary search over the checkpoints plus
+ * a forward scan of at most LT_CKPT_EVERY records.
+ *
+ * With persist_mem=<size>@<phys> (a range kept from the kernel, e.g. with
+ * memmap=<size>$<phys>) the ring buffers live in that range instead. It
+ * holds two slots, each a checksummed header with the ring positions plus
+ * the three rings, and every record carries a CRC. On load the slot with
+ * the newest valid header is kept as the previous boot's log and read in
+ * place; this boot writes to the other one.
+ */
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/console.h>
+#include <linux/crc32.h>
+#include <linux/io.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
 #include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
 
+#include "vgadash.h"
 #include "logtap.h"
+#include "logheat.h"
+#include "alerts.h"
+#include "early.h"
 
-#define LOGBUF_SIZE (64 * 1024)
+#define LT_SNAP_MAX_RECS 1024
+#define LT_CKPT_EVERY    8
+#define LT_CKPT_MAX      256 /* enough for the largest ring of minimum-size records */
+#define LT_OFF_END       U32_MAX
+
+struct lt_rec_hdr {
+	u64 seq;
+	u64 ts_usec;
+	u16 len;      /* text bytes that follow the header */
+	u8 level;
+	u8 flags;
+	u32 prev;     /* footprint of the previous record in this ring, 0 if none */
+	u32 crc;      /* header (crc = 0) + text, persistent rings only */
+	u32 rsvd;
+};
+
+struct lt_ckpt {
+	u64 seq;
+	u64 ts_usec;
+	u32 off;
+};
+
+struct lt_ring {
+	char *buf;
+	u32 size;       /* multiple of 8 */
+	u32 head;       /* next write offset */
+	u32 tail;       /* oldest record */
+	u32 last;       /* newest record */
+	u32 last_size;
+	u32 used;
+	u32 count;
+	u64 dropped;
+	bool crc;       /* checksum records (persistent ring) */
+
+	/* Checkpoints, oldest first, circular */
+	u32 ck_first;
+	u32 ck_count;
+	u32 since_ckpt;
+	struct lt_ckpt ckpt[LT_CKPT_MAX];
+};
+
+struct lt_sel {
+	u8 cls;
+	u32 off;
+};
 
 static DEFINE_SPINLOCK(log_lock);
-static char logbuf[LOGBUF_SIZE];
-static u32 log_head; /* next write */
-static u32 log_len;  /* valid bytes */
+static char ring_crit[LT_RING_CRIT_SIZE] __aligned(8);
+static char ring_warn[LT_RING_WARN_SIZE] __aligned(8);
+static char ring_info[LT_RING_INFO_SIZE] __aligned(8);
 
-static void logtap_write(struct console *con, const char *s, unsigned int n)
+static struct lt_ring rings[LT_NR_CLASSES] = {
+	[LT_CLASS_CRIT] = { .buf = ring_crit, .size = LT_RING_CRIT_SIZE },
+	[LT_CLASS_WARN] = { .buf = ring_warn, .size = LT_RING_WARN_SIZE },
+	[LT_CLASS_INFO] = { .buf = ring_info, .size = LT_RING_INFO_SIZE },
+};
+
+static u64 log_records;
+static u64 log_bytes;
+static u64 log_last_seq;
+
+/* Selection scratch; snap_sel under log_lock, panic_sel for the atomic path */
+static struct lt_sel snap_sel[LT_SNAP_MAX_RECS];
+static struct lt_sel panic_sel[LT_SNAP_MAX_RECS];
+
+static const char * const class_names[LT_NR_CLASSES] = {
+	[LT_CLASS_CRIT] = "crit",
+	[LT_CLASS_WARN] = "warn",
+	[LT_CLASS_INFO] = "info",
+};
+
+static inline u32 rec_size(u32 len)
+{
+	return ALIGN(sizeof(struct lt_rec_hdr) + len, 8);
+}
+
+static inline enum logtap_class level_class(u8 level)
+{
+	if (level <= 3)
+		return LT_CLASS_CRIT;
+	if (level <= 5)
+		return LT_CLASS_WARN;
+	return LT_CLASS_INFO;
+}
+
+static void ring_put(struct lt_ring *r, u32 off, const void *src, u32 n)
+{
+	u32 first = min(n, r->size - off);
+
+	memcpy(r->buf + off, src, first);
+	memcpy(r->buf, (const char *)src + first, n - first);
+}
+
+static void ring_get(const struct lt_ring *r, u32 off, void *dst, u32 n)
+{
+	u32 first = min(n, r->size - off);
+
+	memcpy(dst, r->buf + off, first);
+	memcpy((char *)dst + first, r->buf, n - first);
+}
+
+static inline const struct lt_ckpt *ckpt_at(const struct lt_ring *r, u32 i)
+{
+	return &r->ckpt[(r->ck_first + i) % LT_CKPT_MAX];
+}
+
+static void ckpt_add(struct lt_ring *r, const struct lt_rec_hdr *h, u32 off)
+{
+	struct lt_ckpt *c;
+
+	if (r->ck_count == LT_CKPT_MAX) {
+		r->ck_first = (r->ck_first + 1) % LT_CKPT_MAX;
+		r->ck_count--;
+	}
+
+	c = &r->ckpt[(r->ck_first + r->ck_count) % LT_CKPT_MAX];
+	c->seq = h->seq;
+	c->ts_usec = h->ts_usec;
+	c->off = off;
+	r->ck_count++;
+	r->since_ckpt = 0;
+}
+
+static void ring_drop_oldest(struct lt_ring *r)
+{
+	struct lt_rec_hdr h;
+	u32 sz;
+
+	ring_get(r, r->tail, &h, sizeof(h));
+	sz = rec_size(h.len);
+
+	if (r->ck_count && ckpt_at(r, 0)->off == r->tail) {
+		r->ck_first = (r->ck_first + 1) % LT_CKPT_MAX;
+		r->ck_count--;
+	}
+
+	r->tail = (r->tail + sz) % r->size;
+	r->used -= sz;
+	r->count--;
+	r->dropped++;
+}
+
+static void ring_append(struct lt_ring *r, struct lt_rec_hdr *h, const char *text)
 {
+	u32 need = rec_size(h->len);
+
+	while (r->count && r->size - r->used < need)
+		ring_drop_oldest(r);
+
+	h->prev = r->count ? r->last_size : 0;
+	if (r->crc) {
+		h->crc = 0;
+		h->crc = crc32_le(crc32_le(~0U, (const u8 *)h, sizeof(*h)), text, h->len);
+	}
+	ring_put(r, r->head, h, sizeof(*h));
+	ring_put(r, (r->head + sizeof(*h)) % r->size, text, h->len);
+
+	r->last = r->head;
+	r->last_size = need;
+	r->head = (r->head + need) % r->size;
+	r->used += need;
+	r->count++;
+
+	if (!r->ck_count || ++r->since_ckpt >= LT_CKPT_EVERY)
+		ckpt_add(r, h, r->last);
+}
+
+/* Reads a header, rejecting anything a racing writer could have torn */
+static bool read_hdr(const struct lt_ring *r, u32 off, struct lt_rec_hdr *h)
+{
+	if (off >= r->size || (off & 7))
+		return false;
+
+	ring_get(r, off, h, sizeof(*h));
+	return h->len <= LT_MSG_MAX && h->prev <= r->size && !(h->prev & 7);
+}
+
+/*
+ * Persistent rings.
+ */
+#define LT_PERSIST_MAGIC   0x50444756 /* "VGDP" */
+#define LT_PERSIST_VERSION 2
+#define LT_PERSIST_HDR     PAGE_SIZE
+#define LT_PERSIST_SLOT    (LT_PERSIST_HDR + LT_RING_CRIT_SIZE + LT_RING_WARN_SIZE + LT_RING_INFO_SIZE)
+
+static char *persist_mem;
+module_param(persist_mem, charp, 0444);
+MODULE_PARM_DESC(persist_mem, "Keep the capture rings in reserved RAM across warm reboots: <size>@<phys>");
+
+struct lt_persist_ring {
+	u32 size;
+	u32 head;
+	u32 tail;
+	u32 last;
+	u32 last_size;
+	u32 used;
+	u32 count;
+	u32 rsvd;
+	u64 dropped;
+};
+
+struct lt_persist_hdr {
+	u32 magic;
+	u32 version;
+	u64 boot;        /* 1 for the first boot seen in this range */
+	u64 start_real;  /* wall clock seconds when capture started */
+	u64 boot_real;   /* wall clock seconds at boot: tells a reload from a reboot */
+	u64 last_seq;
+	struct lt_persist_ring ring[LT_NR_CLASSES];
+	u32 crc;         /* over everything above */
+	u32 rsvd;
+};
+
+static struct lt_persist_hdr *persist_cur;  /* this boot's slot */
+static void *persist_prev_map;              /* previous boot's slot, never written */
+
+/* Previous boot, read in place; immutable once loaded */
+static DEFINE_MUTEX(prev_lock);
+static struct lt_ring prev_rings[LT_NR_CLASSES];
+static struct lt_sel prev_sel[LT_SNAP_MAX_RECS];
+static struct logtap_prev_info prev_info = { .why = "persist_mem not set" };
+
+static u32 persist_hdr_crc(const struct lt_persist_hdr *h)
+{
+	return crc32_le(~0U, (const u8 *)h, offsetof(struct lt_persist_hdr, crc));
+}
+
+static inline char *slot_ring(void *slot, int cls)
+{
+	static const u32 off[LT_NR_CLASSES] = {
+		[LT_CLASS_CRIT] = 0,
+		[LT_CLASS_WARN] = LT_RING_CRIT_SIZE,
+		[LT_CLASS_INFO] = LT_RING_CRIT_SIZE + LT_RING_WARN_SIZE,
+	};
+
+	return (char *)slot + LT_PERSIST_HDR + off[cls];
+}
+
+/* Mirror a ring's positions into the slot header; log_lock held */
+static void persist_sync(int cls)
+{
+	struct lt_persist_ring *p = &persist_cur->ring[cls];
+	const struct lt_ring *r = &rings[cls];
+
+	p->head = r->head;
+	p->tail = r->tail;
+	p->last = r->last;
+	p->last_size = r->last_size;
+	p->used = r->used;
+	p->count = r->count;
+	p->dropped = r->dropped;
+	persist_cur->last_seq = log_last_seq;
+	persist_cur->crc = persist_hdr_crc(persist_cur);
+}
+
+static bool persist_hdr_ok(const struct lt_persist_hdr *h)
+{
+	int c;
+
+	if (h->magic != LT_PERSIST_MAGIC || h->version != LT_PERSIST_VERSION ||
+	    h->crc != persist_hdr_crc(h))
+		return false;
+
+	for (c = 0; c < LT_NR_CLASSES; c++) {
+		const struct lt_persist_ring *p = &h->ring[c];
+
+		if (p->size != rings[c].size || p->head >= p->size || p->tail >= p->size ||
+		    p->last >= p->size || p->used > p->size || ((p->head | p->tail | p->last) & 7))
+			return false;
+	}
+	return true;
+}
+
+static u32 ring_crc(const struct lt_ring *r, u32 off, u32 n, u32 crc)
+{
+	u32 first = min(n, r->size - off);
+
+	crc = crc32_le(crc, r->buf + off, first);
+	return crc32_le(crc, r->buf, n - first);
+}
+
+static bool rec_ok(const struct lt_ring *r, u32 off, const struct lt_rec_hdr *h)
+{
+	struct lt_rec_hdr z = *h;
+	u32 crc;
+
+	z.crc = 0;
+	crc = crc32_le(~0U, (const u8 *)&z, sizeof(z));
+	crc = ring_crc(r, (off + sizeof(z)) % r->size, h->len, crc);
+	return crc == h->crc;
+}
+
+/* Keep the newest run of records that check out, walking back from `last` */
+static u32 prev_ring_load(struct lt_ring *r, const struct lt_persist_ring *p, void *slot, int cls)
+{
+	struct lt_rec_hdr h;
+	u64 seq = U64_MAX;
+	u32 off = p->last;
+
+	r->buf = slot_ring(slot, cls);
+	r->size = p->size;
+	r->head = p->head;
+	r->last = p->last;
+	r->last_size = p->last_size;
+	r->dropped = p->dropped;
+	r->count = 0;
+	r->used = 0;
+
+	while (r->count < p->count && read_hdr(r, off, &h) && h.seq < seq && rec_ok(r, off, &h)) {
+		if (!r->count)
+			r->last_size = rec_size(h.len);
+		r->tail = off;
+		r->count++;
+		r->used += rec_size(h.len);
+		seq = h.seq;
+		if (!h.prev)
+			break;
+		off = (off + r->size - h.prev) % r->size;
+	}
+
+	return p->count - r->count;
+}
+
+static int persist_parse(phys_addr_t *base, size_t *size)
+{
+	char *at, *s = persist_mem;
+
+	*size = memparse(s, &at);
+	if (*at != '@' && *at != '$')
+		return -EINVAL;
+	*base = memparse(at + 1, &s);
+	if (*s || !*size)
+		return -EINVAL;
+	if (*size < 2 * LT_PERSIST_SLOT || !PAGE_ALIGNED(*base))
+		return -ENOSPC;
+	return 0;
+}
+
+static u64 persist_boot_real(void)
+{
+	return ktime_get_real_seconds() - ktime_get_boottime_seconds();
+}
+
+/* The slot was written earlier in this boot, by a load before an rmmod */
+static bool persist_same_boot(const struct lt_persist_hdr *h)
+{
+	u64 now = persist_boot_real();
+
+	/* Wall clock steps move the estimate; a reboot takes longer than this */
+	return (h->boot_real > now ? h->boot_real - now : now - h->boot_real) <= 2;
+}
+
+static int persist_init(void)
+{
+	struct lt_persist_hdr *h[2];
+	phys_addr_t base;
+	size_t size;
+	bool ok[2];
+	u64 boot = 1;
+	int prev = -1, newest = -1, cur, c, ret;
+
+	if (!persist_mem || !*persist_mem)
+		return 0;
+
+	ret = persist_parse(&base, &size);
+	if (ret) {
+		pr_warn(VGADASH_NAME ": bad persist_mem=%s: %d\n", persist_mem, ret);
+		return ret;
+	}
+
+	for (c = 0; c < 2; c++) {
+		/*
+		 * Write-combined, as ramoops does: a watchdog or hard reset does
+		 * not write back dirty cache lines, and those would be exactly
+		 * the last records before the hang.
+		 */
+		h[c] = memremap(base + c * LT_PERSIST_SLOT, LT_PERSIST_SLOT, MEMREMAP_WC);
+		if (!h[c]) {
+			if (c)
+				memunmap(h[0]);
+			pr_warn(VGADASH_NAME ": cannot map persist_mem\n");
+			return -ENOMEM;
+		}
+		ok[c] = persist_hdr_ok(h[c]);
+		if (ok[c] && (newest < 0 || h[c]->boot > h[newest]->boot))
+			newest = c;
+	}
+
+	if (newest >= 0 && persist_same_boot(h[newest])) {
+		/* Reloaded: write our own slot again, the other one is still the previous boot */
+		cur = newest;
+		prev = ok[1 - cur] ? 1 - cur : -1;
+		boot = h[cur]->boot;
+	} else {
+		prev = newest;
+		cur = (prev == 0) ? 1 : 0;
+		if (prev >= 0)
+			boot = h[prev]->boot + 1;
+	}
+	persist_cur = h[cur];
+
+	if (prev >= 0) {
+		u32 torn = 0;
+
+		persist_prev_map = h[prev];
+		for (c = 0; c < LT_NR_CLASSES; c++) {
+			torn += prev_ring_load(&prev_rings[c], &h[prev]->ring[c], h[prev], c);
+			prev_info.records += prev_rings[c].count;
+		}
+		prev_info.valid = true;
+		prev_info.boot = h[prev]->boot;
+		prev_info.start_real = h[prev]->start_real;
+		prev_info.last_seq = h[prev]->last_seq;
+		prev_info.torn = torn;
+		prev_info.why = NULL;
+	} else {
+		memunmap(h[1 - cur]);
+		prev_info.why = "no valid previous boot in persist_mem";
+	}
+
+	/* Start this boot's slot empty */
+	memset(persist_cur, 0, sizeof(*persist_cur));
+	persist_cur->magic = LT_PERSIST_MAGIC;
+	persist_cur->version = LT_PERSIST_VERSION;
+	persist_cur->boot = boot;
+	persist_cur->start_real = ktime_get_real_seconds();
+	persist_cur->boot_real = persist_boot_real();
+
+	for (c = 0; c < LT_NR_CLASSES; c++) {
+		rings[c].buf = slot_ring(persist_cur, c);
+		rings[c].crc = true;
+		persist_cur->ring[c].size = rings[c].size;
+	}
+	persist_cur->crc = persist_hdr_crc(persist_cur);
+
+	pr_info(VGADASH_NAME ": persistent capture in slot %d, boot %llu, previous boot %s\n",
+		cur, persist_cur->boot, prev >= 0 ? "found" : "not found");
+	return 0;
+}
+
+static void persist_exit(void)
+{
+	static const u32 sizes[LT_NR_CLASSES] = {
+		[LT_CLASS_CRIT] = LT_RING_CRIT_SIZE,
+		[LT_CLASS_WARN] = LT_RING_WARN_SIZE,
+		[LT_CLASS_INFO] = LT_RING_INFO_SIZE,
+	};
+	static char * const bufs[LT_NR_CLASSES] = {
+		[LT_CLASS_CRIT] = ring_crit,
+		[LT_CLASS_WARN] = ring_warn,
+		[LT_CLASS_INFO] = ring_info,
+	};
 	unsigned long flags;
-	unsigned int i;
+	int c;
 
+	if (!persist_cur)
+		return;
+
+	/* Readers may still come by; hand them the (empty) static rings */
 	spin_lock_irqsave(&log_lock, flags);
-	for (i = 0; i < n; i++) {
-		logbuf[log_head] = s[i];
-		log_head = (log_head + 1) % LOGBUF_SIZE;
-		if (log_len < LOGBUF_SIZE)
-			log_len++;
+	for (c = 0; c < LT_NR_CLASSES; c++) {
+		memset(&rings[c], 0, sizeof(rings[c]));
+		rings[c].buf = bufs[c];
+		rings[c].size = sizes[c];
+	}
+	spin_unlock_irqrestore(&log_lock, flags);
+
+	mutex_lock(&prev_lock);
+	prev_info.valid = false;
+	prev_info.why = "unloaded";
+	mutex_unlock(&prev_lock);
+
+	memunmap(persist_cur);
+	persist_cur = NULL;
+	if (persist_prev_map) {
+		memunmap(persist_prev_map);
+		persist_prev_map = NULL;
+	}
+}
+
+/* "lvl,seq,ts_usec,flags[,...];" -> start of the message, or NULL */
+static const char *parse_ext_header(const char *s, unsigned int n,
+				    u8 *level, u64 *seq, u64 *ts)
+{
+	u64 v[3] = { 0, 0, 0 };
+	unsigned int i = 0;
+	int f = 0;
+
+	while (i < n && f < 3) {
+		char c = s[i++];
+
+		if (c >= '0' && c <= '9')
+			v[f] = v[f] * 10 + (c - '0');
+		else if (c == ',')
+			f++;
+		else
+			return NULL;
+	}
+	if (f < 3)
+		return NULL;
+
+	while (i < n && s[i] != ';')
+		i++;
+	if (i >= n)
+		return NULL;
+
+	*level = v[0] & 7;
+	*seq = v[1];
+	*ts = v[2];
+	return s + i + 1;
+}
+
+static void logtap_write(struct console *con, const char *s, unsigned int n)
+{
+	struct lt_rec_hdr h;
+	const char *msg, *nl;
+	unsigned long flags;
+	unsigned int len;
+	u8 level = LT_LEVEL_NONE;
+	u64 seq = 0, ts = 0;
+	bool have_seq;
+
+	msg = parse_ext_header(s, n, &level, &seq, &ts);
+	have_seq = (msg != NULL);
+	if (!msg) {
+		msg = s;
+		level = LT_LEVEL_NONE;
 	}
+
+	/* Extended records end the message at the first newline; dict lines follow */
+	len = n - (msg - s);
+	nl = memchr(msg, '\n', len);
+	if (nl)
+		len = nl - msg;
+	len = min_t(unsigned int, len, LT_MSG_MAX);
+
+	memset(&h, 0, sizeof(h));
+	h.ts_usec = ts;
+	h.len = len;
+	h.level = level;
+
+	spin_lock_irqsave(&log_lock, flags);
+	h.seq = have_seq ? seq : log_last_seq + 1;
+	log_last_seq = h.seq;
+	ring_append(&rings[level_class(level)], &h, msg);
+	if (persist_cur)
+		persist_sync(level_class(level));
+	log_records++;
+	log_bytes += len;
 	spin_unlock_irqrestore(&log_lock, flags);
+
+	vgadash_logheat_account(level, msg, len);
+	vgadash_alert_log(h.seq, level, msg, len);
+	vgadash_early_paint();
 }
 
 static struct console vgadash_console = {
 	.name  = "vgadash",
 	.write = logtap_write,
-	.flags = CON_ENABLED | CON_ANYTIME | CON_PRINTBUFFER,
+	.flags = CON_ENABLED | CON_ANYTIME | CON_PRINTBUFFER | CON_EXTENDED,
 	.index = -1,
 };
 
+static bool logtap_started;
+
 int vgadash_logtap_init(void)
 {
+	/* Built in, the console_initcall got here first */
+	if (logtap_started)
+		return 0;
+
+	/* A bad persist_mem only costs the persistence, not the capture */
+	persist_init();
 	register_console(&vgadash_console);
+	logtap_started = true;
 	return 0;
 }
 
 void vgadash_logtap_exit(void)
 {
 	unregister_console(&vgadash_console);
+	persist_exit();
+	logtap_started = false;
+}
+
+static int fmt_prefix(char *buf, size_t cap, const struct lt_rec_hdr *h)
+{
+	return scnprintf(buf, cap, "[%5llu.%06llu] ",
+			 (unsigned long long)(h->ts_usec / 1000000),
+			 (unsigned long long)(h->ts_usec % 1000000));
+}
+
+/*
+ * Walk the classes in `mask` backwards from their newest records, always
+ * taking the highest sequence number, until `cap` bytes of text are covered.
+ * Then emit the selection oldest first.
+ */
+static size_t lt_collect(struct lt_ring *rs, u32 mask, char *dst, size_t cap,
+			 struct lt_sel *sel, int max_sel)
+{
+	struct {
+		u32 off;
+		u32 left;
+		struct lt_rec_hdr h;
+	} cur[LT_NR_CLASSES];
+	char prefix[32];
+	size_t total = 0;
+	int nsel = 0, c, i;
+
+	for (c = 0; c < LT_NR_CLASSES; c++) {
+		cur[c].left = 0;
+		if (!(mask & (1U << c)) || !rs[c].count)
+			continue;
+		cur[c].off = rs[c].last;
+		if (read_hdr(&rs[c], cur[c].off, &cur[c].h))
+			cur[c].left = min(rs[c].count, (u32)max_sel);
+	}
+
+	while (nsel < max_sel) {
+		int best = -1;
+		size_t need;
+
+		for (c = 0; c < LT_NR_CLASSES; c++) {
+			if (cur[c].left && (best < 0 || cur[c].h.seq > cur[best].h.seq))
+				best = c;
+		}
+		if (best < 0)
+			break;
+
+		need = fmt_prefix(prefix, sizeof(prefix), &cur[best].h) + cur[best].h.len + 1;
+		if (total + need > cap)
+			break;
+		total += need;
+
+		sel[nsel].cls = best;
+		sel[nsel].off = cur[best].off;
+		nsel++;
+
+		if (--cur[best].left) {
+			struct lt_ring *r = &rs[best];
+
+			cur[best].off = (cur[best].off + r->size - cur[best].h.prev) % r->size;
+			if (!cur[best].h.prev || !read_hdr(r, cur[best].off, &cur[best].h))
+				cur[best].left = 0;
+		}
+	}
+
+	total = 0;
+	for (i = nsel - 1; i >= 0; i--) {
+		const struct lt_ring *r = &rs[sel[i].cls];
+		struct lt_rec_hdr h;
+		int p;
+
+		if (!read_hdr(r, sel[i].off, &h))
+			break;
+
+		p = fmt_prefix(prefix, sizeof(prefix), &h);
+		if (total + p + h.len + 1 > cap)
+			break;
+
+		memcpy(dst + total, prefix, p);
+		total += p;
+		ring_get(r, (sel[i].off + sizeof(h)) % r->size, dst + total, h.len);
+		total += h.len;
+		dst[total++] = '\n';
+	}
+
+	return total;
 }
 
-size_t vgadash_logtap_snapshot(char *dst, size_t cap)
+size_t vgadash_logtap_snapshot_mask(u32 mask, char *dst, size_t cap)
 {
 	unsigned long flags;
-	u32 take, start;
-	size_t i;
+	size_t n;
 
 	spin_lock_irqsave(&log_lock, flags);
+	n = lt_collect(rings, mask, dst, cap, snap_sel, LT_SNAP_MAX_RECS);
+	spin_unlock_irqrestore(&log_lock, flags);
+
+	return n;
+}
+
+/*
+ * Offset of the first record whose seq (or timestamp) is >= want, or
+ * LT_OFF_END. Starts from the last checkpoint below want.
+ */
+static u32 ring_seek(const struct lt_ring *r, u64 want, bool by_time)
+{
+	struct lt_rec_hdr h;
+	u32 lo = 0, hi = r->ck_count, off;
+
+	if (!r->count)
+		return LT_OFF_END;
 
-	take = (log_len < cap) ? log_len : (u32)cap;
-	start = (log_head + LOGBUF_SIZE - take) % LOGBUF_SIZE;
+	while (lo < hi) {
+		u32 mid = (lo + hi) / 2;
+		const struct lt_ckpt *c = ckpt_at(r, mid);
 
-	for (i = 0; i < take; i++)
-		dst[i] = logbuf[(start + i) % LOGBUF_SIZE];
+		if ((by_time ? c->ts_usec : c->seq) < want)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	off = lo ? ckpt_at(r, lo - 1)->off : r->tail;
+
+	for (;;) {
+		if (!read_hdr(r, off, &h))
+			return LT_OFF_END;
+		if ((by_time ? h.ts_usec : h.seq) >= want)
+			return off;
+		if (off == r->last)
+			return LT_OFF_END;
+		off = (off + rec_size(h.len)) % r->size;
+	}
+}
+
+struct lt_cursor {
+	u32 off;
+	struct lt_rec_hdr h;
+};
+
+static bool cursor_load(const struct lt_ring *r, struct lt_cursor *c)
+{
+	return c->off != LT_OFF_END && read_hdr(r, c->off, &c->h);
+}
 
+static void cursor_step(const struct lt_ring *r, struct lt_cursor *c, bool backwards)
+{
+	if (backwards)
+		c->off = (c->off == r->tail || !c->h.prev) ? LT_OFF_END :
+			 (c->off + r->size - c->h.prev) % r->size;
+	else
+		c->off = (c->off == r->last) ? LT_OFF_END :
+			 (c->off + rec_size(c->h.len)) % r->size;
+}
+
+int vgadash_logtap_read(u32 mask, u64 seq, bool backwards,
+			struct logtap_rec *out, int max, char *text, size_t cap)
+{
+	struct lt_cursor cur[LT_NR_CLASSES];
+	bool live[LT_NR_CLASSES];
+	unsigned long flags;
+	size_t used = 0;
+	int n = 0, c;
+
+	spin_lock_irqsave(&log_lock, flags);
+
+	for (c = 0; c < LT_NR_CLASSES; c++) {
+		const struct lt_ring *r = &rings[c];
+
+		live[c] = false;
+		if (!(mask & (1U << c)) || !r->count)
+			continue;
+
+		cur[c].off = ring_seek(r, seq, false);
+		if (backwards) {
+			/* Step back from the first record at or past seq */
+			if (cur[c].off == LT_OFF_END)
+				cur[c].off = r->last;
+			else if (cursor_load(r, &cur[c]))
+				cursor_step(r, &cur[c], true);
+			else
+				cur[c].off = LT_OFF_END;
+		}
+		live[c] = cursor_load(r, &cur[c]);
+	}
+
+	while (n < max) {
+		int best = -1;
+
+		for (c = 0; c < LT_NR_CLASSES; c++) {
+			if (!live[c])
+				continue;
+			if (best < 0 || (backwards ? cur[c].h.seq > cur[best].h.seq :
+						     cur[c].h.seq < cur[best].h.seq))
+				best = c;
+		}
+		if (best < 0)
+			break;
+
+		if (text) {
+			const struct lt_ring *r = &rings[best];
+
+			if (used + cur[best].h.len > cap)
+				break;
+			ring_get(r, (cur[best].off + sizeof(cur[best].h)) % r->size,
+				 text + used, cur[best].h.len);
+			out[n].text = text + used;
+			used += cur[best].h.len;
+		} else {
+			out[n].text = NULL;
+		}
+		out[n].seq = cur[best].h.seq;
+		out[n].ts_usec = cur[best].h.ts_usec;
+		out[n].level = cur[best].h.level;
+		out[n].len = cur[best].h.len;
+		n++;
+
+		cursor_step(&rings[best], &cur[best], backwards);
+		live[best] = cursor_load(&rings[best], &cur[best]);
+	}
+
+	spin_unlock_irqrestore(&log_lock, flags);
+
+	return n;
+}
+
+u64 vgadash_logtap_seq_at(u32 mask, u64 ts_usec)
+{
+	struct lt_rec_hdr h;
+	unsigned long flags;
+	u64 seq = U64_MAX;
+	u32 off;
+	int c;
+
+	spin_lock_irqsave(&log_lock, flags);
+	for (c = 0; c < LT_NR_CLASSES; c++) {
+		if (!(mask & (1U << c)))
+			continue;
+		off = ring_seek(&rings[c], ts_usec, true);
+		if (off != LT_OFF_END && read_hdr(&rings[c], off, &h))
+			seq = min(seq, h.seq);
+	}
 	spin_unlock_irqrestore(&log_lock, flags);
 
-	return take;
+	return seq;
+}
+
+size_t vgadash_logtap_snapshot_atomic(char *dst, size_t cap)
+{
+	unsigned long flags;
+	bool locked;
+	size_t n;
+
+	local_irq_save(flags);
+	locked = spin_trylock(&log_lock);
+
+	n = lt_collect(rings, LT_MASK_ALL, dst, cap, panic_sel, LT_SNAP_MAX_RECS);
+
+	if (locked)
+		spin_unlock(&log_lock);
+	local_irq_restore(flags);
+
+	return n;
+}
+
+void vgadash_logtap_prev_info(struct logtap_prev_info *out)
+{
+	mutex_lock(&prev_lock);
+	*out = prev_info;
+	mutex_unlock(&prev_lock);
+}
+
+size_t vgadash_logtap_prev_snapshot(char *dst, size_t cap)
+{
+	size_t n = 0;
+
+	mutex_lock(&prev_lock);
+	if (prev_info.valid)
+		n = lt_collect(prev_rings, LT_MASK_ALL, dst, cap, prev_sel, LT_SNAP_MAX_RECS);
+	mutex_unlock(&prev_lock);
+
+	return n;
+}
+
+/* Every surviving record, oldest first, formatted straight from the slot */
+void vgadash_logtap_prev_show(struct seq_file *m)
+{
+	struct lt_cursor cur[LT_NR_CLASSES];
+	bool live[LT_NR_CLASSES];
+	char prefix[32];
+	int c;
+
+	mutex_lock(&prev_lock);
+	if (!prev_info.valid) {
+		mutex_unlock(&prev_lock);
+		return;
+	}
+
+	for (c = 0; c < LT_NR_CLASSES; c++) {
+		cur[c].off = prev_rings[c].count ? prev_rings[c].tail : LT_OFF_END;
+		live[c] = cursor_load(&prev_rings[c], &cur[c]);
+	}
+
+	for (;;) {
+		const struct lt_ring *r;
+		int best = -1;
+		u32 off, first;
+
+		for (c = 0; c < LT_NR_CLASSES; c++) {
+			if (live[c] && (best < 0 || cur[c].h.seq < cur[best].h.seq))
+				best = c;
+		}
+		if (best < 0)
+			break;
+
+		r = &prev_rings[best];
+		off = (cur[best].off + sizeof(cur[best].h)) % r->size;
+		first = min_t(u32, cur[best].h.len, r->size - off);
+
+		fmt_prefix(prefix, sizeof(prefix), &cur[best].h);
+		seq_puts(m, prefix);
+		seq_write(m, r->buf + off, first);
+		seq_write(m, r->buf, cur[best].h.len - first);
+		seq_putc(m, '\n');
+
+		cursor_step(r, &cur[best], false);
+		live[best] = cursor_load(r, &cur[best]);
+	}
+	mutex_unlock(&prev_lock);
+}
+
+void vgadash_logtap_counters(u64 *records, u64 *bytes)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&log_lock, flags);
+	*records = log_records;
+	*bytes = log_bytes;
+	spin_unlock_irqrestore(&log_lock, flags);
+}
+
+void vgadash_logtap_class_stats(enum logtap_class cls, struct logtap_class_stats *out)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&log_lock, flags);
+	out->size = rings[cls].size;
+	out->used = rings[cls].used;
+	out->records = rings[cls].count;
+	out->dropped = rings[cls].dropped;
+	spin_unlock_irqrestore(&log_lock, flags);
+}
+
+const char *vgadash_logtap_class_name(enum logtap_class cls)
+{
+	return class_names[cls];
+}
+
+u32 vgadash_logtap_parse_mask(const char *s)
+{
+	char buf[32], *p, *tok;
+	u32 mask = 0;
+	int c;
+
+	strscpy(buf, s, sizeof(buf));
+	p = strim(buf);
+
+	while ((tok = strsep(&p, ",")) != NULL) {
+		if (!strcmp(tok, "all")) {
+			mask |= LT_MASK_ALL;
+			continue;
+		}
+		for (c = 0; c < LT_NR_CLASSES; c++) {
+			if (!strcmp(tok, class_names[c]))
+				break;
+		}
+		if (c == LT_NR_CLASSES)
+			return 0;
+		mask |= 1U << c;
+	}
+
+	return mask;
+}
+
+int vgadash_logtap_mask_str(u32 mask, char *buf, size_t cap)
+{
+	int c, n = 0;
+
+	buf[0] = '\0';
+	for (c = 0; c < LT_NR_CLASSES; c++) {
+		if (mask & (1U << c))
+			n += scnprintf(buf + n, cap - n, "%s%s", n ? "," : "", class_names[c]);
+	}
+
+	return n;
 }
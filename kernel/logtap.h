@@ -5,10 +5,104 @@
 #include <linux/types.h>
 #include <linux/seq_file.h>
 
+/*
+ * Captured records are split by severity so an info flood cannot evict
+ * errors. Each class has its own ring and byte budget.
+ */
+enum logtap_class {
+	LT_CLASS_CRIT = 0, /* emerg .. err */
+	LT_CLASS_WARN = 1, /* warning, notice */
+	LT_CLASS_INFO = 2, /* info, debug, unknown */
+	LT_NR_CLASSES,
+};
+
+#define LT_MASK_ALL ((1U << LT_NR_CLASSES) - 1)
+
+#define LT_RING_CRIT_SIZE (16 * 1024)
+#define LT_RING_WARN_SIZE (16 * 1024)
+#define LT_RING_INFO_SIZE (32 * 1024)
+
+#define LT_MSG_MAX 1024 /* longer messages are truncated */
+#define LT_LEVEL_NONE 0xFF
+
+struct logtap_class_stats {
+	u32 size;
+	u32 used;
+	u32 records;
+	u64 dropped;  /* records evicted to make room */
+};
+
 int  vgadash_logtap_init(void);
 void vgadash_logtap_exit(void);
 
-/* Copy last bytes from the ring into dst (linear), returns length copied */
-size_t vgadash_logtap_snapshot(char *dst, size_t cap);
+/*
+ * Copy the newest records of the classes in `mask` into dst as text lines
+ * ("[secs.usecs] message\n"), merged back into sequence order. Returns the
+ * length copied; only whole lines are copied.
+ */
+size_t vgadash_logtap_snapshot_mask(u32 mask, char *dst, size_t cap);
+
+static inline size_t vgadash_logtap_snapshot(char *dst, size_t cap)
+{
+	return vgadash_logtap_snapshot_mask(LT_MASK_ALL, dst, cap);
+}
+
+/*
+ * Same as vgadash_logtap_snapshot() but never spins: if the lock is busy the
+ * rings are read without it. For panic/oops paths only.
+ */
+size_t vgadash_logtap_snapshot_atomic(char *dst, size_t cap);
+
+/* One record as returned by vgadash_logtap_read() */
+struct logtap_rec {
+	u64 seq;
+	u64 ts_usec;
+	u16 len;
+	u8 level;
+	const char *text; /* len bytes, not NUL-terminated; NULL if not copied */
+};
+
+/*
+ * Random access by sequence number. Forward: up to `max` records of the
+ * classes in `mask` with seq >= `seq`, oldest first. Backwards: records with
+ * seq < `seq`, newest first. Message text is copied into `text` until `cap`
+ * runs out; pass text = NULL to only fetch headers. Returns the count.
+ */
+int vgadash_logtap_read(u32 mask, u64 seq, bool backwards,
+			struct logtap_rec *out, int max, char *text, size_t cap);
+
+/* Sequence number of the first record at or after ts_usec; U64_MAX if none */
+u64 vgadash_logtap_seq_at(u32 mask, u64 ts_usec);
+
+/* Capture kept from the previous boot (persist_mem) */
+struct logtap_prev_info {
+	bool valid;
+	u64 boot;        /* boot number within the reserved range */
+	u64 start_real;  /* wall clock seconds when that capture started */
+	u64 last_seq;
+	u32 records;     /* records that passed their checksum */
+	u32 torn;        /* records dropped for a bad checksum */
+	const char *why; /* reason when !valid */
+};
+
+void vgadash_logtap_prev_info(struct logtap_prev_info *out);
+
+/* Like vgadash_logtap_snapshot(), over the previous boot's rings */
+size_t vgadash_logtap_prev_snapshot(char *dst, size_t cap);
+
+/* All of the previous boot's records as text lines */
+void vgadash_logtap_prev_show(struct seq_file *m);
+
+/* Records and bytes captured since load */
+void vgadash_logtap_counters(u64 *records, u64 *bytes);
+
+void vgadash_logtap_class_stats(enum logtap_class cls, struct logtap_class_stats *out);
+const char *vgadash_logtap_class_name(enum logtap_class cls);
+
+/* Parse "crit,warn", "all", ... into a class mask; returns 0 if invalid */
+u32 vgadash_logtap_parse_mask(const char *s);
+
+/* Format a class mask as "crit,warn"; returns the length written */
+int vgadash_logtap_mask_str(u32 mask, char *buf, size_t cap);
 
 #endif
@@ -1,119 +1,807 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <linux/module.h>
 #include <linux/kernel.h>
+#include <linux/atomic.h>
+#include <linux/bitops.h>
 #include <linux/init.h>
+#include <linux/jiffies.h>
+#include <linux/string.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 
 #include "vgadash.h"
 #include "vga_text.h"
 #include "logtap.h"
+#include "logheat.h"
+#include "tpstats.h"
+#include "iostats.h"
+#include "cgstats.h"
+#include "cpu_timers.h"
+#include "oncpu.h"
+#include "heartbeat.h"
+#include "latency.h"
+#include "sampler.h"
+#include "metrics.h"
+#include "panic.h"
+#include "recorder.h"
+#include "frame.h"
+#include "backend.h"
+#include "layout.h"
+#include "hotkeys.h"
+#include "alerts.h"
+#include "early.h"
 #include "pages.h"
 
 struct vgadash_ctx g_vgadash;
 
+static unsigned int refresh_ms = 1000;
+module_param(refresh_ms, uint, 0644);
+MODULE_PARM_DESC(refresh_ms, "Redraw interval while the dashboard is on (0 = only on demand)");
+
+/*
+ * Serializes page/toggle changes against rendering. Frames are only ever
+ * drawn by refresh_work (the render owner); writers change state under the
+ * lock, then kick the owner and wait for the frame to be published.
+ */
+static DEFINE_MUTEX(vgadash_lock);
+static struct delayed_work refresh_work;
+static atomic_t render_offscreen = ATOMIC_INIT(0);
+static unsigned long layout_next = MAX_JIFFY_OFFSET; /* until a tile is due */
+
+/* Keys queued from interrupt context, drained by the render owner */
+#define INPUT_QUEUE 16
+static DEFINE_SPINLOCK(input_lock);
+static u8 input_q[INPUT_QUEUE];
+static unsigned int input_head, input_tail;
+
+/* Frame outputs, attached while the dashboard is on */
+static const struct vgadash_backend *const backends[] = {
+	&vgadash_fb_backend,
+	&vgadash_vga_backend,
+	&vgadash_serial_backend,
+};
+static unsigned long backends_attached;
+
+const struct vgadash_page_ops vgadash_pages[VGADASH_NR_PAGES] = {
+	[VGADASH_PAGE_STATE] = {
+		.name       = "state",
+		.render_vga = page_state_render_vga,
+		.details    = page_state_details,
+	},
+	[VGADASH_PAGE_LOGS] = {
+		.name       = "logs",
+		.render_vga = page_logs_render_vga,
+		.details    = page_logs_details,
+	},
+	[VGADASH_PAGE_HEAT] = {
+		.name       = "heat",
+		.render_vga = page_heat_render_vga,
+		.details    = page_heat_details,
+	},
+	[VGADASH_PAGE_SCHED] = {
+		.name       = "sched",
+		.render_vga = page_sched_render_vga,
+		.details    = page_sched_details,
+		.enter      = vgadash_tp_start,
+		.leave      = vgadash_tp_stop,
+	},
+	[VGADASH_PAGE_IO] = {
+		.name       = "io",
+		.render_vga = page_io_render_vga,
+		.details    = page_io_details,
+		.enter      = vgadash_io_start,
+		.leave      = vgadash_io_stop,
+	},
+	[VGADASH_PAGE_LAT] = {
+		.name       = "lat",
+		.render_vga = page_lat_render_vga,
+		.details    = page_lat_details,
+		.enter      = vgadash_lat_start,
+		.leave      = vgadash_lat_stop,
+	},
+	[VGADASH_PAGE_PREV] = {
+		.name       = "prev",
+		.render_vga = page_prev_render_vga,
+		.details    = page_prev_details,
+	},
+	[VGADASH_PAGE_CGROUP] = {
+		.name       = "cgroup",
+		.render_vga = page_cgroup_render_vga,
+		.details    = page_cgroup_details,
+		.enter      = vgadash_cg_start,
+		.leave      = vgadash_cg_stop,
+	},
+	[VGADASH_PAGE_ONCPU] = {
+		.name       = "oncpu",
+		.render_vga = page_oncpu_render_vga,
+		.details    = page_oncpu_details,
+		.enter      = vgadash_oncpu_start,
+		.leave      = vgadash_oncpu_stop,
+	},
+	[VGADASH_PAGE_STALL] = {
+		.name       = "stall",
+		.render_vga = page_stall_render_vga,
+		.details    = page_stall_details,
+		.enter      = vgadash_hb_start,
+		.leave      = vgadash_hb_stop,
+	},
+};
+
+const char *vgadash_page_name(enum vgadash_page p)
+{
+	if (p == VGADASH_PAGE_TILES)
+		return "tiles";
+	return vgadash_pages[p].name;
+}
+
+/* Returns the page index for `name` (trailing newline allowed), or -EINVAL */
+int vgadash_page_by_name(const char *name)
+{
+	int i;
+
+	for (i = 0; i < VGADASH_NR_PAGES; i++) {
+		if (sysfs_streq(name, vgadash_pages[i].name))
+			return i;
+	}
+	return -EINVAL;
+}
+
 static void render_header(void)
 {
 	const u8 attr = 0x1F; /* bright white on blue */
 	char buf[VGA_COLS + 1];
-	int i;
+	char tag[40];
+	int n;
 
 	memset(buf, ' ', VGA_COLS);
 	buf[VGA_COLS] = '\0';
 
 	memcpy(buf, " VGADASH ", 9);
 
-	if (g_vgadash.page == VGADASH_PAGE_STATE)
-		memcpy(buf + VGA_COLS - 14, "[page:state]", 12);
-	else
-		memcpy(buf + VGA_COLS - 13, "[page:logs]", 11);
-
-	for (i = 0; i < VGA_COLS; i++) {
-		/* write char-by-char via vga_text_puts_at is expensive;
-		   but this is called rarely. We'll just use puts_at in chunks. */
+	/* "[page:<name>]" or "[tiles:<a>+<b>]" right-aligned, two columns from the edge */
+	if (vgadash_layout_active()) {
+		n = scnprintf(tag, sizeof(tag), "[tiles:");
+		n += vgadash_layout_names(tag + n, sizeof(tag) - n - 1);
+		n += scnprintf(tag + n, sizeof(tag) - n, "]");
+	} else {
+		n = scnprintf(tag, sizeof(tag), "[page:%s]", vgadash_page_name(g_vgadash.page));
 	}
+	memcpy(buf + VGA_COLS - 2 - n, tag, n);
 
 	/* Cheap chunk approach */
-	vga_text_puts_at(g_vgadash.vga_mem, 0, 0, buf, attr);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 0, buf, attr);
 }
 
-void vgadash_render(void)
+/* Render owner only, with vgadash_lock held */
+static void render_frame(void)
 {
-	if (!g_vgadash.vga_mem)
-		return;
+	u8 page = g_vgadash.page;
 
-	vga_text_clear(g_vgadash.vga_mem, 0x07, VGA_CELLS);
+	vga_frame_clear(g_vgadash.canvas, 0x07, VGA_CELLS);
 	render_header();
-	vga_text_puts_at(g_vgadash.vga_mem, 0, 1,
-			 "--------------------------------------------------------------------------------", 0x08);
 
-	if (g_vgadash.page == VGADASH_PAGE_STATE)
-		page_state_render_vga();
-	else
-		page_logs_render_vga();
+	if (vgadash_layout_active()) {
+		/* Tile titles take the separator row */
+		layout_next = vgadash_layout_render(g_vgadash.canvas, refresh_ms);
+		page = VGADASH_PAGE_TILES;
+	} else {
+		vga_frame_puts_at(g_vgadash.canvas, 0, 1,
+				 "--------------------------------------------------------------------------------", 0x08);
+		vgadash_pages[g_vgadash.page].render_vga();
+		layout_next = MAX_JIFFY_OFFSET;
+	}
+
+	if (g_vgadash.active) {
+		int i;
+
+		for_each_set_bit(i, &backends_attached, ARRAY_SIZE(backends))
+			backends[i]->flush(g_vgadash.canvas);
+		vgadash_recorder_add(g_vgadash.canvas, page);
+	}
+	vgadash_frame_publish(g_vgadash.canvas, page);
 }
 
-void vgadash_toggle(void)
+/* Keep the page enter/leave hooks in step with what is on screen */
+static void update_page_hooks(void)
 {
-	int ret;
+	unsigned long want = 0, gone, added;
+	int p;
 
-	if (!g_vgadash.active) {
-		ret = vga_text_ensure_mapped(&g_vgadash.vga_mem);
-		if (ret) {
-			pr_err(VGADASH_NAME ": ioremap VGA failed: %d\n", ret);
-			return;
+	if (g_vgadash.active)
+		want = vgadash_layout_active() ? vgadash_layout_pages() : BIT(g_vgadash.page);
+
+	gone = g_vgadash.entered & ~want;
+	added = want & ~g_vgadash.entered;
+
+	for_each_set_bit(p, &gone, VGADASH_NR_PAGES) {
+		if (vgadash_pages[p].leave)
+			vgadash_pages[p].leave();
+	}
+
+	g_vgadash.entered = want;
+
+	for_each_set_bit(p, &added, VGADASH_NR_PAGES) {
+		if (vgadash_pages[p].enter)
+			vgadash_pages[p].enter();
+	}
+}
+
+/* Does not pull in an earlier kick that is already pending */
+static void schedule_refresh(void)
+{
+	unsigned long delay = refresh_ms ? msecs_to_jiffies(refresh_ms) : MAX_JIFFY_OFFSET;
+
+	/* Tiles run on their own intervals */
+	if (vgadash_layout_active())
+		delay = layout_next;
+	if (delay != MAX_JIFFY_OFFSET)
+		queue_delayed_work(system_wq, &refresh_work, delay);
+}
+
+/* On if at least one backend attaches; returns the first error otherwise */
+static int activate_locked(void)
+{
+	bool have_screen = false;
+	int i, err, ret = -ENODEV;
+
+	/* An explicit on: render over an oops paint again */
+	vgadash_panic_release();
+
+	backends_attached = 0;
+	for (i = 0; i < ARRAY_SIZE(backends); i++) {
+		if (backends[i]->screen && have_screen)
+			continue;
+		err = backends[i]->attach();
+		if (!err) {
+			have_screen |= backends[i]->screen;
+			__set_bit(i, &backends_attached);
+		} else if (ret == -ENODEV) {
+			ret = err;
 		}
+	}
+	if (!backends_attached)
+		return ret;
 
-		vga_text_save(g_vgadash.vga_mem, g_vgadash.saved, VGA_CELLS);
-		vga_cursor_save_and_disable(&g_vgadash.cursor_start_saved,
-					    &g_vgadash.cursor_end_saved,
-					    &g_vgadash.cursor_saved);
+	g_vgadash.active = true;
+	vgadash_layout_touch(-1);
+	update_page_hooks();
+	return 0;
+}
 
-		g_vgadash.active = true;
-		vgadash_render();
-	} else {
-		vga_text_restore(g_vgadash.vga_mem, g_vgadash.saved, VGA_CELLS);
-		vga_cursor_restore(g_vgadash.cursor_start_saved,
-				   g_vgadash.cursor_end_saved,
-				   g_vgadash.cursor_saved);
+static void deactivate_locked(void)
+{
+	int i;
+
+	vgadash_panic_release();
+
+	for_each_set_bit(i, &backends_attached, ARRAY_SIZE(backends))
+		backends[i]->detach();
+	backends_attached = 0;
+
+	g_vgadash.active = false;
+	update_page_hooks();
+}
+
+static const u8 key_scroll[] = {
+	[VGADASH_KEY_LINE_UP]   = LOGS_LINE_UP,
+	[VGADASH_KEY_LINE_DOWN] = LOGS_LINE_DOWN,
+	[VGADASH_KEY_PAGE_UP]   = LOGS_PAGE_UP,
+	[VGADASH_KEY_PAGE_DOWN] = LOGS_PAGE_DOWN,
+	[VGADASH_KEY_TOP]       = LOGS_TOP,
+	[VGADASH_KEY_BOTTOM]    = LOGS_BOTTOM,
+};
+
+static void apply_key_locked(enum vgadash_key key)
+{
+	switch (key) {
+	case VGADASH_KEY_TOGGLE:
+		if (g_vgadash.active)
+			deactivate_locked();
+		else
+			activate_locked();
+		return;
+	case VGADASH_KEY_OFF:
+		if (g_vgadash.active)
+			deactivate_locked();
+		return;
+	default:
+		break;
+	}
+
+	if (!g_vgadash.active)
+		return;
 
-		g_vgadash.active = false;
+	switch (key) {
+	case VGADASH_KEY_NEXT_PAGE:
+	case VGADASH_KEY_PREV_PAGE:
+		g_vgadash.page = (g_vgadash.page + (key == VGADASH_KEY_NEXT_PAGE ? 1 :
+				  VGADASH_NR_PAGES - 1)) % VGADASH_NR_PAGES;
+		break;
+	default:
+		/* Scrolling is about the logs; bring them up if needed */
+		g_vgadash.page = VGADASH_PAGE_LOGS;
+		page_logs_scroll(key_scroll[key], 0);
+		vgadash_layout_touch(VGADASH_PAGE_LOGS);
+		break;
 	}
+	update_page_hooks();
+}
+
+static void apply_input_locked(void)
+{
+	u8 keys[INPUT_QUEUE];
+	int n = 0, i;
+
+	spin_lock_irq(&input_lock);
+	while (input_tail != input_head)
+		keys[n++] = input_q[input_tail++ % INPUT_QUEUE];
+	spin_unlock_irq(&input_lock);
+
+	for (i = 0; i < n; i++)
+		apply_key_locked(keys[i]);
+}
+
+void vgadash_input(enum vgadash_key key)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&input_lock, flags);
+	if (input_head - input_tail < INPUT_QUEUE)
+		input_q[input_head++ % INPUT_QUEUE] = key;
+	spin_unlock_irqrestore(&input_lock, flags);
+
+	/* Safe from hard irq; the owner picks the key up on its next pass */
+	mod_delayed_work(system_wq, &refresh_work, 0);
+}
+
+static void refresh_work_fn(struct work_struct *work)
+{
+	bool offscreen = atomic_xchg(&render_offscreen, 0);
+
+	mutex_lock(&vgadash_lock);
+	apply_input_locked();
+	/* Leave the oops on screen, and stop the refresh with it */
+	if (READ_ONCE(g_vgadash.emergency) && g_vgadash.active) {
+		mutex_unlock(&vgadash_lock);
+		return;
+	}
+	if (g_vgadash.active || offscreen)
+		render_frame();
+	if (g_vgadash.active)
+		schedule_refresh();
+	mutex_unlock(&vgadash_lock);
+}
+
+/* Have the owner render now and wait until it is done; call without the lock */
+static void kick_render(void)
+{
+	mod_delayed_work(system_wq, &refresh_work, 0);
+	flush_delayed_work(&refresh_work);
+}
+
+void vgadash_request_frame(void)
+{
+	atomic_set(&render_offscreen, 1);
+	kick_render();
+}
+
+void vgadash_toggle(void)
+{
+	bool kick = false;
+
+	mutex_lock(&vgadash_lock);
+
+	if (!g_vgadash.active)
+		kick = !activate_locked();
+	else
+		deactivate_locked();
+
+	mutex_unlock(&vgadash_lock);
+
+	if (kick)
+		kick_render();
 }
 
 int vgadash_set_page(enum vgadash_page p)
 {
+	bool kick;
+
+	if (p >= VGADASH_NR_PAGES)
+		return -EINVAL;
+
+	mutex_lock(&vgadash_lock);
 	g_vgadash.page = p;
-	if (g_vgadash.active)
-		vgadash_render();
+	update_page_hooks();
+	kick = g_vgadash.active;
+	mutex_unlock(&vgadash_lock);
+
+	if (kick)
+		kick_render();
 	return 0;
 }
 
+/* Switch on if off; unlike vgadash_toggle() never switches off */
+int vgadash_activate(void)
+{
+	bool kick = false;
+	int ret = 0;
+
+	mutex_lock(&vgadash_lock);
+	if (!g_vgadash.active) {
+		ret = activate_locked();
+		kick = !ret;
+	}
+	mutex_unlock(&vgadash_lock);
+
+	if (kick)
+		kick_render();
+	return ret;
+}
+
+/* No render of its own: callers switch to the logs page right after */
+void vgadash_pin_log(u64 seq)
+{
+	mutex_lock(&vgadash_lock);
+	/* The record may be of a class the view filters out */
+	g_vgadash.log_view = LT_MASK_ALL;
+	page_logs_scroll(LOGS_PIN, seq);
+	vgadash_layout_touch(VGADASH_PAGE_LOGS);
+	mutex_unlock(&vgadash_lock);
+}
+
+int vgadash_set_log_view(u32 mask)
+{
+	bool kick;
+
+	if (!mask || (mask & ~LT_MASK_ALL))
+		return -EINVAL;
+
+	mutex_lock(&vgadash_lock);
+	g_vgadash.log_view = mask;
+	vgadash_layout_touch(VGADASH_PAGE_LOGS);
+	kick = g_vgadash.active && (g_vgadash.entered & BIT(VGADASH_PAGE_LOGS));
+	mutex_unlock(&vgadash_lock);
+
+	if (kick)
+		kick_render();
+	return 0;
+}
+
+enum ctl_op {
+	CTL_PAGE,
+	CTL_ON,
+	CTL_OFF,
+	CTL_TOGGLE,
+	CTL_REFRESH,
+	CTL_LOGVIEW,
+	CTL_SCROLL,
+};
+
+struct ctl_cmd {
+	enum ctl_op op;
+	u32 arg;
+	u64 val; /* CTL_SCROLL argument */
+};
+
+static const char * const scroll_verbs[] = {
+	[LOGS_LINE_UP]   = "up",
+	[LOGS_LINE_DOWN] = "down",
+	[LOGS_PAGE_UP]   = "pgup",
+	[LOGS_PAGE_DOWN] = "pgdn",
+	[LOGS_TOP]       = "top",
+	[LOGS_BOTTOM]    = "bottom",
+};
+
+/* "<secs>[.<fraction>]" as printed in log prefixes -> microseconds */
+static int parse_usec(char *s, u64 *out)
+{
+	char *frac = strchr(s, '.');
+	u64 secs, us = 0;
+	size_t i, len = 0;
+
+	if (frac) {
+		*frac++ = '\0';
+		len = strlen(frac);
+		if (!len || len > 6 || kstrtou64(frac, 10, &us))
+			return -EINVAL;
+	}
+	if (kstrtou64(s, 10, &secs))
+		return -EINVAL;
+
+	for (i = len; i < 6; i++)
+		us *= 10;
+	*out = secs * USEC_PER_SEC + us;
+	return 0;
+}
+
+static int ctl_parse_one(char *s, struct ctl_cmd *c)
+{
+	char *verb = strsep(&s, " \t");
+	char *arg = s ? strim(s) : NULL;
+
+	if (!strcmp(verb, "on") || !strcmp(verb, "off") ||
+	    !strcmp(verb, "toggle") || !strcmp(verb, "refresh")) {
+		if (arg && *arg)
+			return -EINVAL;
+		c->op = !strcmp(verb, "on") ? CTL_ON :
+			!strcmp(verb, "off") ? CTL_OFF :
+			!strcmp(verb, "toggle") ? CTL_TOGGLE : CTL_REFRESH;
+		return 0;
+	}
+
+	if (!arg || !*arg)
+		return -EINVAL;
+
+	if (!strcmp(verb, "page")) {
+		int p = vgadash_page_by_name(arg);
+
+		if (p < 0)
+			return p;
+		c->op = CTL_PAGE;
+		c->arg = p;
+		return 0;
+	}
+
+	if (!strcmp(verb, "scroll")) {
+		int i = match_string(scroll_verbs, ARRAY_SIZE(scroll_verbs), arg);
+
+		if (i < 0)
+			return i;
+		c->op = CTL_SCROLL;
+		c->arg = i;
+		c->val = 0;
+		return 0;
+	}
+
+	if (!strcmp(verb, "seq") || !strcmp(verb, "time") || !strcmp(verb, "wrap")) {
+		int ret;
+
+		c->op = CTL_SCROLL;
+		if (!strcmp(verb, "seq")) {
+			c->arg = LOGS_SEQ;
+			ret = kstrtou64(arg, 10, &c->val);
+		} else if (!strcmp(verb, "time")) {
+			c->arg = LOGS_TIME;
+			ret = parse_usec(arg, &c->val);
+		} else {
+			bool on;
+
+			c->arg = LOGS_WRAP;
+			ret = kstrtobool(arg, &on);
+			c->val = on;
+		}
+		return ret ? -EINVAL : 0;
+	}
+
+	if (!strcmp(verb, "logview") || !strcmp(verb, "filter")) {
+		c->arg = vgadash_logtap_parse_mask(arg);
+		if (!c->arg)
+			return -EINVAL;
+		c->op = CTL_LOGVIEW;
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
+/*
+ * Run a batch of ';' or newline separated commands. The batch is parsed in
+ * full first, so an invalid command rejects all of it; then it is folded into
+ * the target state and applied under one lock, followed by at most one render.
+ */
+int vgadash_ctl(char *batch)
+{
+	struct ctl_cmd cmds[VGADASH_CTL_MAX_CMDS];
+	bool active, refresh = false, scrolled = false;
+	enum vgadash_page page, prev_page;
+	u32 log_view, prev_view;
+	char *tok;
+	int n = 0, i, ret = 0;
+
+	while ((tok = strsep(&batch, ";\n")) != NULL) {
+		tok = strim(tok);
+		if (!*tok)
+			continue;
+		if (n == VGADASH_CTL_MAX_CMDS)
+			return -E2BIG;
+		ret = ctl_parse_one(tok, &cmds[n]);
+		if (ret)
+			return ret;
+		n++;
+	}
+
+	mutex_lock(&vgadash_lock);
+
+	active = g_vgadash.active;
+	page = prev_page = g_vgadash.page;
+	log_view = prev_view = g_vgadash.log_view;
+
+	for (i = 0; i < n; i++) {
+		switch (cmds[i].op) {
+		case CTL_PAGE:
+			page = cmds[i].arg;
+			break;
+		case CTL_ON:
+			active = true;
+			break;
+		case CTL_OFF:
+			active = false;
+			break;
+		case CTL_TOGGLE:
+			active = !active;
+			break;
+		case CTL_REFRESH:
+			refresh = true;
+			break;
+		case CTL_LOGVIEW:
+			log_view = cmds[i].arg;
+			break;
+		case CTL_SCROLL:
+			/* Relative moves need the view they apply to */
+			g_vgadash.log_view = log_view;
+			page_logs_scroll(cmds[i].arg, cmds[i].val);
+			scrolled = true;
+			break;
+		}
+	}
+
+	if (scrolled) {
+		vgadash_layout_touch(VGADASH_PAGE_LOGS);
+		refresh = true;
+	}
+
+	if (log_view != g_vgadash.log_view)
+		vgadash_layout_touch(VGADASH_PAGE_LOGS);
+	if (refresh)
+		vgadash_layout_touch(-1);
+
+	refresh |= page != g_vgadash.page || log_view != g_vgadash.log_view;
+	g_vgadash.page = page;
+	g_vgadash.log_view = log_view;
+
+	/* The page hooks run for the new page, so it goes in first */
+	if (active && !g_vgadash.active) {
+		ret = activate_locked();
+		if (ret) {
+			/* Nothing attached: the batch leaves the dashboard as it was */
+			g_vgadash.page = prev_page;
+			g_vgadash.log_view = prev_view;
+		}
+		refresh |= !ret;
+	} else if (!active && g_vgadash.active) {
+		deactivate_locked();
+	} else {
+		update_page_hooks();
+	}
+
+	refresh &= g_vgadash.active;
+
+	mutex_unlock(&vgadash_lock);
+
+	if (refresh)
+		kick_render();
+	return ret;
+}
+
+int vgadash_set_layout(char *spec)
+{
+	struct layout_spec ls;
+	bool kick;
+	int ret;
+
+	ret = vgadash_layout_parse(spec, &ls);
+	if (ret)
+		return ret;
+
+	mutex_lock(&vgadash_lock);
+	vgadash_layout_apply(&ls);
+	update_page_hooks();
+	kick = g_vgadash.active;
+	mutex_unlock(&vgadash_lock);
+
+	if (kick)
+		kick_render();
+	return 0;
+}
+
+void vgadash_layout_show(struct seq_file *m)
+{
+	mutex_lock(&vgadash_lock);
+	vgadash_layout_seq_show(m);
+	mutex_unlock(&vgadash_lock);
+}
+
+void vgadash_backends_show(struct seq_file *m)
+{
+	int i;
+
+	mutex_lock(&vgadash_lock);
+	for (i = 0; i < ARRAY_SIZE(backends); i++) {
+		seq_printf(m, "%-8s %-9s ", backends[i]->name,
+			   test_bit(i, &backends_attached) ? "attached" : "-");
+		backends[i]->show(m);
+	}
+	mutex_unlock(&vgadash_lock);
+}
+
 static int __init vgadash_init(void)
 {
+	bool boot_on;
 	int ret;
 
-	memset(&g_vgadash, 0, sizeof(g_vgadash));
+	/* Built in: stop the early boot painter before anything can fail */
+	boot_on = vgadash_early_handoff();
+
+	/* Zero from load; built in, the early painter has mapped VGA memory */
 	g_vgadash.page = VGADASH_PAGE_STATE;
+	g_vgadash.entered = 0;
+	g_vgadash.rows = VGA_ROWS;
+	g_vgadash.log_view = LT_MASK_ALL;
+	g_vgadash.canvas = g_vgadash.frame;
+	INIT_DELAYED_WORK(&refresh_work, refresh_work_fn);
 
-	ret = vgadash_debugfs_init();
+	ret = vgadash_metrics_init();
 	if (ret)
 		return ret;
 
+	ret = vgadash_debugfs_init();
+	if (ret) {
+		vgadash_metrics_exit();
+		return ret;
+	}
+
+	ret = vgadash_panic_init();
+	if (ret)
+		pr_warn(VGADASH_NAME ": panic painter disabled: %d\n", ret);
+
+	ret = vgadash_recorder_init();
+	if (ret)
+		pr_warn(VGADASH_NAME ": frame recorder disabled: %d\n", ret);
+
+	vgadash_logheat_init();
+
 	/* Start capturing printk console output into our ring buffer */
 	vgadash_logtap_init();
+	vgadash_sampler_init();
+
+	ret = vgadash_cpu_timers_init();
+	if (ret)
+		pr_warn(VGADASH_NAME ": per-CPU timers disabled: %d\n", ret);
+	vgadash_hb_init();
+	vgadash_hotkeys_init();
 
 	pr_info(VGADASH_NAME ": loaded (console-tap logs enabled)\n");
+
+	/* Built in with boot_on: the dashboard replaces the early boot painter */
+	if (boot_on) {
+		vgadash_set_page(VGADASH_PAGE_LOGS);
+		vgadash_activate();
+	}
 	return 0;
 }
 
 static void __exit vgadash_exit(void)
 {
+	vgadash_hotkeys_exit();
+	vgadash_panic_exit();
 	vgadash_logtap_exit();
+	vgadash_alerts_exit();
 
 	/* Restore screen if active */
 	if (g_vgadash.active)
 		vgadash_toggle();
 
+	cancel_delayed_work_sync(&refresh_work);
+	vgadash_hb_exit();
+	vgadash_cpu_timers_exit();
+	vgadash_sampler_exit();
 	vgadash_debugfs_exit();
+	vgadash_frame_exit();
+	vgadash_recorder_exit();
+	vgadash_metrics_exit();
+	vgadash_tp_exit();
 
 	if (g_vgadash.vga_mem) {
 		iounmap(g_vgadash.vga_mem);
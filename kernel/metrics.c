@@ -0,0 +1,286 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Machine-readable metrics in the Prometheus/OpenMetrics text format.
+ *
+ * The sampling tick formats the cached values (the same ones the pages show)
+ * into a back buffer and swaps it in. Readers only copy the finished text,
+ * so a scrape costs one memcpy no matter how often it happens.
+ */
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/sched/loadavg.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "vgadash.h"
+#include "sampler.h"
+#include "logtap.h"
+#include "logheat.h"
+#include "iostats.h"
+#include "backend.h"
+#include "metrics.h"
+
+#define METRICS_CAP (64 * 1024)
+
+struct mbuf {
+	char *p;
+	size_t len;
+};
+
+static DEFINE_MUTEX(metrics_lock);
+static struct mbuf bufs[2];
+static int cur;                 /* index of the published buffer */
+static struct io_row *io_rows;  /* scratch for the io tables */
+
+static __printf(2, 3) void m_printf(struct mbuf *b, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	b->len += vscnprintf(b->p + b->len, METRICS_CAP - b->len, fmt, args);
+	va_end(args);
+}
+
+/*
+ * A counter family is named without the _total suffix its samples carry,
+ * e.g. family vgadash_log_records, sample vgadash_log_records_total.
+ */
+static void m_family(struct mbuf *b, const char *name, const char *type,
+		     const char *unit, const char *help)
+{
+	m_printf(b, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+	if (unit)
+		m_printf(b, "# UNIT %s %s\n", name, unit);
+}
+
+/* Label values may not carry raw quotes or backslashes */
+static void m_label_value(char *dst, size_t cap, const char *src)
+{
+	size_t i = 0;
+
+	for (; *src && i + 2 < cap; src++) {
+		if (*src == '"' || *src == '\\')
+			dst[i++] = '\\';
+		dst[i++] = *src;
+	}
+	dst[i] = '\0';
+}
+
+static void build_system(struct mbuf *b, const struct sampler_snap *s)
+{
+	static const char * const windows[3] = { "1m", "5m", "15m" };
+	int i;
+
+	m_family(b, "vgadash_sample_seq", "counter", NULL, "Sampling ticks since load.");
+	m_printf(b, "vgadash_sample_seq_total %llu\n", s->seq);
+
+	m_family(b, "vgadash_uptime_seconds", "gauge", "seconds", "Time since boot.");
+	m_printf(b, "vgadash_uptime_seconds %llu\n", s->uptime_s);
+
+	m_family(b, "vgadash_cpus_online", "gauge", NULL, "Online CPUs.");
+	m_printf(b, "vgadash_cpus_online %u\n", s->cpus_online);
+
+	m_family(b, "vgadash_memory_total_bytes", "gauge", "bytes", "Total RAM.");
+	m_printf(b, "vgadash_memory_total_bytes %llu\n", s->mem_total_mib << 20);
+
+	m_family(b, "vgadash_memory_free_bytes", "gauge", "bytes", "Free RAM.");
+	m_printf(b, "vgadash_memory_free_bytes %llu\n", s->mem_free_mib << 20);
+
+	m_family(b, "vgadash_load_average", "gauge", NULL, "Run-queue load average.");
+	for (i = 0; i < 3; i++)
+		m_printf(b, "vgadash_load_average{window=\"%s\"} %lu.%02lu\n", windows[i],
+			 LOAD_INT(s->load[i]), LOAD_FRAC(s->load[i]));
+
+	m_family(b, "vgadash_log_records", "counter", NULL, "Console records captured.");
+	m_printf(b, "vgadash_log_records_total %llu\n", s->log_records);
+
+	m_family(b, "vgadash_log_bytes", "counter", "bytes", "Console bytes captured.");
+	m_printf(b, "vgadash_log_bytes_total %llu\n", s->log_bytes);
+}
+
+static void build_rings(struct mbuf *b)
+{
+	struct logtap_class_stats st[LT_NR_CLASSES];
+	int c;
+
+	for (c = 0; c < LT_NR_CLASSES; c++)
+		vgadash_logtap_class_stats(c, &st[c]);
+
+	m_family(b, "vgadash_log_ring_used_bytes", "gauge", "bytes", "Capture ring bytes in use per level class.");
+	for (c = 0; c < LT_NR_CLASSES; c++)
+		m_printf(b, "vgadash_log_ring_used_bytes{class=\"%s\"} %u\n",
+			 vgadash_logtap_class_name(c), st[c].used);
+
+	m_family(b, "vgadash_log_ring_size_bytes", "gauge", "bytes", "Capture ring budget per level class.");
+	for (c = 0; c < LT_NR_CLASSES; c++)
+		m_printf(b, "vgadash_log_ring_size_bytes{class=\"%s\"} %u\n",
+			 vgadash_logtap_class_name(c), st[c].size);
+
+	m_family(b, "vgadash_log_ring_dropped", "counter", NULL, "Records evicted from a full capture ring.");
+	for (c = 0; c < LT_NR_CLASSES; c++)
+		m_printf(b, "vgadash_log_ring_dropped_total{class=\"%s\"} %llu\n",
+			 vgadash_logtap_class_name(c), st[c].dropped);
+}
+
+static void build_serial(struct mbuf *b)
+{
+	u64 frames, bytes;
+	u32 last;
+
+	vgadash_serial_stats(&frames, &bytes, &last);
+
+	m_family(b, "vgadash_serial_frames", "counter", NULL, "Frames sent to the serial mirror.");
+	m_printf(b, "vgadash_serial_frames_total %llu\n", frames);
+
+	m_family(b, "vgadash_serial_bytes", "counter", "bytes", "Bytes sent to the serial mirror.");
+	m_printf(b, "vgadash_serial_bytes_total %llu\n", bytes);
+
+	m_family(b, "vgadash_serial_frame_bytes", "gauge", "bytes", "Size of the last frame sent to the serial mirror.");
+	m_printf(b, "vgadash_serial_frame_bytes %u\n", last);
+}
+
+static void build_heat(struct mbuf *b)
+{
+	struct logheat_row rows[LOGHEAT_TOPK];
+	char tag[2 * LOGHEAT_TAG_LEN];
+	int n, i;
+
+	n = vgadash_logheat_top(rows, LOGHEAT_TOPK);
+
+	m_family(b, "vgadash_log_emitter_lines_per_second", "gauge", NULL,
+		 "Top console emitters, lines/s over the 10 s window.");
+	for (i = 0; i < n; i++) {
+		m_label_value(tag, sizeof(tag), rows[i].tag);
+		m_printf(b, "vgadash_log_emitter_lines_per_second{tag=\"%s\",level=\"%d\"} %u.%u\n",
+			 tag, rows[i].level == LOGHEAT_LEVEL_NONE ? -1 : rows[i].level,
+			 rows[i].lines_win / LOGHEAT_WINDOW, rows[i].lines_win % LOGHEAT_WINDOW);
+	}
+
+	m_family(b, "vgadash_log_emitter_bytes_per_second", "gauge", "bytes_per_second",
+		 "Top console emitters, bytes/s over the 10 s window.");
+	for (i = 0; i < n; i++) {
+		m_label_value(tag, sizeof(tag), rows[i].tag);
+		m_printf(b, "vgadash_log_emitter_bytes_per_second{tag=\"%s\",level=\"%d\"} %u.%u\n",
+			 tag, rows[i].level == LOGHEAT_LEVEL_NONE ? -1 : rows[i].level,
+			 rows[i].bytes_win / LOGHEAT_WINDOW, rows[i].bytes_win % LOGHEAT_WINDOW);
+	}
+}
+
+/* Only populated while the io page keeps the io sampler running */
+static void build_io(struct mbuf *b)
+{
+	char dev[2 * IO_NAME_LEN];
+	int n, i;
+
+	n = vgadash_io_top(IO_DISK, io_rows, IO_MAX_DEVS);
+	m_family(b, "vgadash_disk_ops_per_second", "gauge", NULL, "Completed disk I/Os per second.");
+	for (i = 0; i < n; i++) {
+		m_label_value(dev, sizeof(dev), io_rows[i].name);
+		m_printf(b, "vgadash_disk_ops_per_second{device=\"%s\",op=\"read\"} %u\n"
+			 "vgadash_disk_ops_per_second{device=\"%s\",op=\"write\"} %u\n",
+			 dev, io_rows[i].rd_ops, dev, io_rows[i].wr_ops);
+	}
+	m_family(b, "vgadash_disk_bytes_per_second", "gauge", "bytes_per_second", "Disk throughput.");
+	for (i = 0; i < n; i++) {
+		m_label_value(dev, sizeof(dev), io_rows[i].name);
+		m_printf(b, "vgadash_disk_bytes_per_second{device=\"%s\",op=\"read\"} %llu\n"
+			 "vgadash_disk_bytes_per_second{device=\"%s\",op=\"write\"} %llu\n",
+			 dev, io_rows[i].rd_bytes, dev, io_rows[i].wr_bytes);
+	}
+	m_family(b, "vgadash_disk_inflight", "gauge", NULL, "Disk requests in flight.");
+	for (i = 0; i < n; i++) {
+		m_label_value(dev, sizeof(dev), io_rows[i].name);
+		m_printf(b, "vgadash_disk_inflight{device=\"%s\"} %u\n",
+			 dev, io_rows[i].inflight);
+	}
+	m_family(b, "vgadash_disk_busy_ratio", "gauge", NULL, "Share of the interval the disk was busy.");
+	for (i = 0; i < n; i++) {
+		m_label_value(dev, sizeof(dev), io_rows[i].name);
+		m_printf(b, "vgadash_disk_busy_ratio{device=\"%s\"} %u.%02u\n",
+			 dev, io_rows[i].busy_pct / 100, io_rows[i].busy_pct % 100);
+	}
+
+	n = vgadash_io_top(IO_NET, io_rows, IO_MAX_DEVS);
+	m_family(b, "vgadash_net_packets_per_second", "gauge", NULL, "Network packets per second.");
+	for (i = 0; i < n; i++) {
+		m_label_value(dev, sizeof(dev), io_rows[i].name);
+		m_printf(b, "vgadash_net_packets_per_second{device=\"%s\",dir=\"rx\"} %u\n"
+			 "vgadash_net_packets_per_second{device=\"%s\",dir=\"tx\"} %u\n",
+			 dev, io_rows[i].rd_ops, dev, io_rows[i].wr_ops);
+	}
+	m_family(b, "vgadash_net_bytes_per_second", "gauge", "bytes_per_second", "Network throughput.");
+	for (i = 0; i < n; i++) {
+		m_label_value(dev, sizeof(dev), io_rows[i].name);
+		m_printf(b, "vgadash_net_bytes_per_second{device=\"%s\",dir=\"rx\"} %llu\n"
+			 "vgadash_net_bytes_per_second{device=\"%s\",dir=\"tx\"} %llu\n",
+			 dev, io_rows[i].rd_bytes, dev, io_rows[i].wr_bytes);
+	}
+	m_family(b, "vgadash_net_drops_per_second", "gauge", NULL, "Network rx + tx drops per second.");
+	for (i = 0; i < n; i++) {
+		m_label_value(dev, sizeof(dev), io_rows[i].name);
+		m_printf(b, "vgadash_net_drops_per_second{device=\"%s\"} %u\n",
+			 dev, io_rows[i].drops);
+	}
+}
+
+void vgadash_metrics_rebuild(void)
+{
+	struct sampler_snap s;
+	struct mbuf *b;
+
+	if (!io_rows)
+		return;
+
+	vgadash_sampler_latest(&s);
+
+	/* Only the tick writes, so the back buffer is ours until the swap */
+	b = &bufs[!cur];
+	b->len = 0;
+
+	build_system(b, &s);
+	build_rings(b);
+	build_serial(b);
+	build_heat(b);
+	build_io(b);
+	m_printf(b, "# EOF\n");
+
+	mutex_lock(&metrics_lock);
+	cur = !cur;
+	mutex_unlock(&metrics_lock);
+}
+
+char *vgadash_metrics_dup(size_t *len)
+{
+	char *copy;
+
+	mutex_lock(&metrics_lock);
+	*len = bufs[cur].len;
+	copy = kmemdup(bufs[cur].p, *len + 1, GFP_KERNEL);
+	mutex_unlock(&metrics_lock);
+
+	return copy;
+}
+
+int vgadash_metrics_init(void)
+{
+	bufs[0].p = kvzalloc(METRICS_CAP, GFP_KERNEL);
+	bufs[1].p = kvzalloc(METRICS_CAP, GFP_KERNEL);
+	io_rows = kvmalloc_array(IO_MAX_DEVS, sizeof(*io_rows), GFP_KERNEL);
+
+	if (!bufs[0].p || !bufs[1].p || !io_rows) {
+		vgadash_metrics_exit();
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+void vgadash_metrics_exit(void)
+{
+	kvfree(bufs[0].p);
+	kvfree(bufs[1].p);
+	kvfree(io_rows);
+	bufs[0].p = NULL;
+	bufs[1].p = NULL;
+	io_rows = NULL;
+}
@@ -0,0 +1,16 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <linux/types.h>
+
+int  vgadash_metrics_init(void);
+void vgadash_metrics_exit(void);
+
+/* Re-format the exposition text from the cached samples (sampling tick only) */
+void vgadash_metrics_rebuild(void);
+
+/* kmalloc'ed copy of the current exposition text; caller kfree()s */
+char *vgadash_metrics_dup(size_t *len);
+
+#endif
@@ -0,0 +1,222 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * What every CPU is running right now.
+ *
+ * The runqueues are private to the scheduler, so each CPU samples itself:
+ * a pinned hard-irq hrtimer records the interrupted task, its state and the
+ * context it was in (user, kernel, preempt/bh off, softirq, irq) into a
+ * per-CPU slot under a seqcount. Sampling needs no cross-CPU calls, and
+ * the page reads the slots from any CPU without locks; only arming the
+ * timers touches the remote CPUs.
+ *
+ * Run time since the last reschedule comes from the task's switch counts:
+ * while the same pid shows up with unchanged nvcsw + nivcsw, it has not left
+ * the CPU since the first such sample. That is exact to within one period.
+ * A slot that stops updating means the CPU could not take the timer, which
+ * usually is a long irqs-off section; it is shown as stale.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/preempt.h>
+#include <linux/ptrace.h>
+#include <linux/sched.h>
+#include <linux/seqlock.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+#include <asm/irq_regs.h>
+
+#include "cpu_timers.h"
+#include "oncpu.h"
+
+#define ONCPU_STALE_PERIODS 4
+
+static unsigned int oncpu_period_ms = 100;
+module_param(oncpu_period_ms, uint, 0644);
+MODULE_PARM_DESC(oncpu_period_ms, "oncpu page sampling period in ms (applies when the page is entered)");
+
+static unsigned int oncpu_long_ms = 1000;
+module_param(oncpu_long_ms, uint, 0644);
+MODULE_PARM_DESC(oncpu_long_ms, "Flag tasks on the oncpu page that ran this long without a reschedule");
+
+struct oncpu_sample {
+	pid_t pid;
+	char comm[TASK_COMM_LEN];
+	char state;
+	u8 ctx;
+	u64 since_ns;
+	u64 stamp_ns;
+};
+
+struct oncpu_pcpu {
+	struct hrtimer timer;
+	seqcount_t seq;
+	unsigned long nsw; /* nvcsw + nivcsw at since_ns */
+	struct oncpu_sample s;
+};
+
+static DEFINE_PER_CPU(struct oncpu_pcpu, oncpu_pcpu);
+
+static enum hrtimer_restart oncpu_timer_fn(struct hrtimer *t);
+static void oncpu_cpu_online(unsigned int cpu);
+
+static struct vgadash_cpu_timers oncpu_timers = {
+	.timers = &oncpu_pcpu.timer,
+	.fn     = oncpu_timer_fn,
+	.online = oncpu_cpu_online,
+};
+
+static DEFINE_MUTEX(oncpu_lock);
+static bool oncpu_running;
+
+static u8 oncpu_ctx(struct task_struct *p)
+{
+	struct pt_regs *regs = get_irq_regs();
+	/* preempt_count() of the code the timer interrupt landed on */
+	unsigned int pc = preempt_count() - HARDIRQ_OFFSET;
+
+	if (pc & HARDIRQ_MASK)
+		return ONCPU_IRQ;
+	if (pc & SOFTIRQ_OFFSET)
+		return ONCPU_SOFTIRQ;
+	if (is_idle_task(p))
+		return ONCPU_IDLE;
+	if (regs && user_mode(regs))
+		return ONCPU_USER;
+	if (pc & (PREEMPT_MASK | SOFTIRQ_MASK))
+		return ONCPU_NOPREEMPT;
+	return ONCPU_KERNEL;
+}
+
+static enum hrtimer_restart oncpu_timer_fn(struct hrtimer *t)
+{
+	struct oncpu_pcpu *oc = container_of(t, struct oncpu_pcpu, timer);
+	struct task_struct *p = current;
+	unsigned long nsw = p->nvcsw + p->nivcsw;
+	pid_t pid = task_pid_nr(p);
+	u64 now = ktime_get_ns();
+
+	raw_write_seqcount_begin(&oc->seq);
+	if (pid != oc->s.pid || nsw != oc->nsw || !oc->s.since_ns) {
+		oc->s.since_ns = now;
+		oc->nsw = nsw;
+	}
+	oc->s.pid = pid;
+	/* Only a /proc comm write can race with this; a torn name is harmless */
+	memcpy(oc->s.comm, p->comm, TASK_COMM_LEN);
+	oc->s.comm[TASK_COMM_LEN - 1] = '\0';
+	oc->s.state = task_state_to_char(p);
+	oc->s.ctx = oncpu_ctx(p);
+	oc->s.stamp_ns = now;
+	raw_write_seqcount_end(&oc->seq);
+
+	hrtimer_forward_now(t, oncpu_timers.period);
+	return HRTIMER_RESTART;
+}
+
+/* A CPU (back) online: forget the sample from before it went down */
+static void oncpu_cpu_online(unsigned int cpu)
+{
+	struct oncpu_pcpu *oc = per_cpu_ptr(&oncpu_pcpu, cpu);
+
+	raw_write_seqcount_begin(&oc->seq);
+	memset(&oc->s, 0, sizeof(oc->s));
+	oc->nsw = 0;
+	raw_write_seqcount_end(&oc->seq);
+}
+
+void vgadash_oncpu_start(void)
+{
+	int cpu;
+
+	mutex_lock(&oncpu_lock);
+	if (!oncpu_running) {
+		for_each_possible_cpu(cpu) {
+			struct oncpu_pcpu *oc = per_cpu_ptr(&oncpu_pcpu, cpu);
+
+			seqcount_init(&oc->seq);
+			memset(&oc->s, 0, sizeof(oc->s));
+			oc->nsw = 0;
+		}
+
+		oncpu_timers.period = ms_to_ktime(max(oncpu_period_ms, 1U));
+		vgadash_cpu_timers_start(&oncpu_timers);
+		oncpu_running = true;
+	}
+	mutex_unlock(&oncpu_lock);
+}
+
+void vgadash_oncpu_stop(void)
+{
+	mutex_lock(&oncpu_lock);
+	if (oncpu_running) {
+		vgadash_cpu_timers_cancel(&oncpu_timers);
+		oncpu_running = false;
+	}
+	mutex_unlock(&oncpu_lock);
+}
+
+/* Returns false if the CPU has not been sampled yet */
+static bool oncpu_read_cpu(int cpu, u64 now, u64 long_ns, struct oncpu_row *r)
+{
+	struct oncpu_pcpu *oc = per_cpu_ptr(&oncpu_pcpu, cpu);
+	struct oncpu_sample s;
+	unsigned int seq;
+
+	do {
+		seq = read_seqcount_begin(&oc->seq);
+		s = oc->s;
+	} while (read_seqcount_retry(&oc->seq, seq));
+
+	if (!s.stamp_ns)
+		return false;
+
+	r->cpu = cpu;
+	r->pid = s.pid;
+	memcpy(r->comm, s.comm, sizeof(r->comm));
+	r->state = s.state;
+	r->ctx = s.ctx;
+	r->run_ns = s.stamp_ns - s.since_ns;
+	r->age_ns = now > s.stamp_ns ? now - s.stamp_ns : 0;
+	r->stale = r->age_ns > ONCPU_STALE_PERIODS * (u64)ktime_to_ns(oncpu_timers.period);
+	r->long_run = r->ctx != ONCPU_IDLE && r->run_ns >= long_ns;
+	return true;
+}
+
+int vgadash_oncpu_read(struct oncpu_row *out, int max, struct oncpu_summary *sum)
+{
+	struct oncpu_row r;
+	u64 now, long_ns;
+	int cpu, n = 0;
+
+	memset(sum, 0, sizeof(*sum));
+
+	mutex_lock(&oncpu_lock);
+	sum->running = oncpu_running;
+	sum->period_ms = ktime_to_ms(oncpu_timers.period);
+	sum->long_ms = READ_ONCE(oncpu_long_ms);
+	if (!oncpu_running)
+		goto out;
+
+	now = ktime_get_ns();
+	long_ns = (u64)sum->long_ms * NSEC_PER_MSEC;
+	for_each_cpu(cpu, &oncpu_timers.armed) {
+		if (!oncpu_read_cpu(cpu, now, long_ns, &r))
+			continue;
+
+		sum->cpus++;
+		if (r.ctx == ONCPU_IDLE)
+			sum->idle++;
+		if (r.long_run)
+			sum->long_runs++;
+		if (r.stale)
+			sum->stale++;
+		if (n < max)
+			out[n++] = r;
+	}
+out:
+	mutex_unlock(&oncpu_lock);
+
+	return n;
+}
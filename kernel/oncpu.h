@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _ONCPU_H_
+#define _ONCPU_H_
+
+#include <linux/types.h>
+#include <linux/sched.h>
+
+/* What the sampling timer interrupted */
+enum oncpu_ctx {
+	ONCPU_IDLE,
+	ONCPU_USER,
+	ONCPU_KERNEL,     /* preemptible */
+	ONCPU_NOPREEMPT,  /* preemption or bottom halves disabled */
+	ONCPU_SOFTIRQ,
+	ONCPU_IRQ,
+};
+
+struct oncpu_row {
+	int cpu;
+	pid_t pid;
+	char comm[TASK_COMM_LEN];
+	char state;       /* task_state_to_char() */
+	u8 ctx;           /* enum oncpu_ctx */
+	bool stale;       /* no sample for several periods: irqs off? */
+	bool long_run;    /* run_ns >= oncpu_long_ms */
+	u64 run_ns;       /* on CPU since its last switch, to within a period */
+	u64 age_ns;       /* since the sample was taken */
+};
+
+struct oncpu_summary {
+	bool running;
+	u32 period_ms;
+	u32 long_ms;
+	int cpus;
+	int idle;
+	int long_runs;
+	int stale;
+};
+
+void vgadash_oncpu_start(void);
+void vgadash_oncpu_stop(void);
+
+/* Copy rows for armed CPUs in CPU order; returns rows filled */
+int vgadash_oncpu_read(struct oncpu_row *out, int max, struct oncpu_summary *sum);
+
+#endif
@@ -4,10 +4,55 @@
 
 #include <linux/seq_file.h>
 
+struct vgadash_page_ops {
+	const char *name;
+	void (*render_vga)(void);
+	void (*details)(struct seq_file *m); /* longer text form, not bound by the frame */
+
+	/* Optional: called when the page goes on / comes off screen */
+	void (*enter)(void);
+	void (*leave)(void);
+};
+
+extern const struct vgadash_page_ops vgadash_pages[];
+
+/* Logs page scrollback; render lock held */
+enum logs_scroll {
+	LOGS_LINE_UP,
+	LOGS_LINE_DOWN,
+	LOGS_PAGE_UP,
+	LOGS_PAGE_DOWN,
+	LOGS_TOP,
+	LOGS_BOTTOM,    /* follow the newest records again; drops a pin */
+	LOGS_SEQ,       /* arg: sequence number */
+	LOGS_TIME,      /* arg: timestamp in us */
+	LOGS_WRAP,      /* arg: 0/1 */
+	LOGS_PIN,       /* arg: sequence number, held on screen and highlighted */
+};
+
+void page_logs_scroll(enum logs_scroll op, u64 arg);
+int  page_logs_position(char *buf, size_t cap);
+
 void page_state_render_vga(void);
 void page_logs_render_vga(void);
+void page_heat_render_vga(void);
+void page_sched_render_vga(void);
+void page_io_render_vga(void);
+void page_lat_render_vga(void);
+void page_prev_render_vga(void);
+void page_cgroup_render_vga(void);
+void page_oncpu_render_vga(void);
+void page_stall_render_vga(void);
 
-void page_state_snapshot(struct seq_file *m);
-void page_logs_snapshot(struct seq_file *m);
+void page_state_details(struct seq_file *m);
+void page_logs_details(struct seq_file *m);
+void page_heat_details(struct seq_file *m);
+void page_sched_details(struct seq_file *m);
+void page_io_details(struct seq_file *m);
+void page_lat_details(struct seq_file *m);
+void page_prev_details(struct seq_file *m);
+void page_cgroup_details(struct seq_file *m);
+void page_oncpu_details(struct seq_file *m);
+void page_stall_details(struct seq_file *m);
 
 #endif
@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/seq_file.h>
+#include <linux/sched/loadavg.h>
+
+#include "vgadash.h"
+#include "vga_text.h"
+#include "cgstats.h"
+#include "pages.h"
+
+#define CG_NAME_COLS 30
+#define CG_PSI_WARN  (10 * FIXED_1) /* some avg10 >= 10% */
+
+static const char cg_hdr[] =
+	"CGROUP                            CPU%      MEM     PEAK  P.cpu  P.mem   P.io";
+
+static void format_mem(char *buf, size_t cap, bool valid, u64 bytes)
+{
+	if (valid)
+		snprintf(buf, cap, "%7lluM", (unsigned long long)(bytes >> 20));
+	else
+		snprintf(buf, cap, "%8s", "-");
+}
+
+static void format_row(char *line, size_t cap, const struct cg_row *r)
+{
+	char name[CG_NAME_COLS + 1], cur[16], peak[16];
+	size_t len = strlen(r->name);
+
+	/* The leaf end of a long path is the part that tells cgroups apart */
+	if (len > CG_NAME_COLS)
+		snprintf(name, sizeof(name), "...%s", r->name + len - (CG_NAME_COLS - 3));
+	else
+		strscpy(name, r->name, sizeof(name));
+
+	format_mem(cur, sizeof(cur), r->has_mem, r->mem_cur);
+	format_mem(peak, sizeof(peak), r->has_mem, r->mem_peak);
+
+	snprintf(line, cap, "%-30s %5u.%u %s %s %3lu.%02lu %3lu.%02lu %3lu.%02lu",
+		 name, r->cpu_x100 / 100, (r->cpu_x100 % 100) / 10, cur, peak,
+		 LOAD_INT(r->psi_cpu), LOAD_FRAC(r->psi_cpu),
+		 LOAD_INT(r->psi_mem), LOAD_FRAC(r->psi_mem),
+		 LOAD_INT(r->psi_io), LOAD_FRAC(r->psi_io));
+}
+
+static void format_title(char *line, size_t cap)
+{
+	struct cg_walk_stats ws;
+
+	vgadash_cg_walk_stats(&ws);
+	if (!ws.passes)
+		snprintf(line, cap, "Cgroups, busiest first (walking...)");
+	else
+		snprintf(line, cap, "Cgroups to depth %u, busiest first: %u (%u not tracked), %u tick pass",
+			 ws.depth, ws.groups, ws.skipped, ws.ticks);
+}
+
+void page_cgroup_render_vga(void)
+{
+	struct cg_row *rows;
+	char line[VGA_COLS + 1];
+	int n, i, y = 2;
+
+	const int max_rows = g_vgadash.rows - 4;
+
+	format_title(line, sizeof(line));
+	vga_frame_puts_at(g_vgadash.canvas, 0, y++, line, 0x0F);
+	vga_frame_puts_at(g_vgadash.canvas, 0, y++, cg_hdr, 0x0F);
+
+	if (max_rows <= 0)
+		return;
+
+	rows = kmalloc_array(max_rows, sizeof(*rows), GFP_KERNEL);
+	if (!rows) {
+		vga_frame_puts_at(g_vgadash.canvas, 0, y, "cgroup: kmalloc(rows) failed", 0x0F);
+		return;
+	}
+
+	n = vgadash_cg_top(rows, max_rows);
+	if (n == 0)
+		vga_frame_puts_at(g_vgadash.canvas, 0, y, "(none)", 0x08);
+
+	for (i = 0; i < n; i++) {
+		const struct cg_row *r = &rows[i];
+		bool stalled = r->psi_cpu >= CG_PSI_WARN || r->psi_mem >= CG_PSI_WARN ||
+			       r->psi_io >= CG_PSI_WARN;
+
+		format_row(line, sizeof(line), r);
+		vga_frame_puts_at(g_vgadash.canvas, 0, y++, line, stalled ? 0x0E : 0x07);
+	}
+
+	kfree(rows);
+}
+
+void page_cgroup_details(struct seq_file *m)
+{
+	struct cg_row *rows;
+	char line[VGA_COLS + 1];
+	int n, i;
+
+	format_title(line, sizeof(line));
+	seq_printf(m, "%s\n%s\n", line, cg_hdr);
+
+	rows = kmalloc_array(CG_MAX_GROUPS, sizeof(*rows), GFP_KERNEL);
+	if (!rows) {
+		seq_puts(m, "cgroup: kmalloc(rows) failed\n");
+		return;
+	}
+
+	n = vgadash_cg_top(rows, CG_MAX_GROUPS);
+	if (n == 0)
+		seq_puts(m, "(none)\n");
+
+	/* Full paths here; the screen elides them */
+	for (i = 0; i < n; i++) {
+		format_row(line, sizeof(line), &rows[i]);
+		seq_printf(m, "%s  %s\n", line, rows[i].name);
+	}
+
+	kfree(rows);
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/seq_file.h>
+
+#include "vgadash.h"
+#include "vga_text.h"
+#include "logheat.h"
+#include "pages.h"
+
+static const char heat_hdr[] =
+	"TAG             LVL  LINES/s  LINES/s(10s)   BYTES/s  BYTES/s(10s)";
+
+static void format_row(char *line, size_t cap, const struct logheat_row *r)
+{
+	char lvl[4];
+
+	if (r->level == LOGHEAT_LEVEL_NONE)
+		strscpy(lvl, "-", sizeof(lvl));
+	else
+		snprintf(lvl, sizeof(lvl), "%u", r->level);
+
+	/* 10s rates keep one decimal: the window sum is already rate * 10 */
+	snprintf(line, cap, "%-15.15s %3s %8u %10u.%u %9u %10u.%u",
+		 r->tag, lvl, r->lines_1s,
+		 r->lines_win / LOGHEAT_WINDOW, r->lines_win % LOGHEAT_WINDOW,
+		 r->bytes_1s,
+		 r->bytes_win / LOGHEAT_WINDOW, r->bytes_win % LOGHEAT_WINDOW);
+}
+
+void page_heat_render_vga(void)
+{
+	struct logheat_row rows[LOGHEAT_TOPK];
+	char line[VGA_COLS + 1];
+	int n, i;
+
+	const int max_rows = g_vgadash.rows - 4;
+
+	vga_frame_puts_at(g_vgadash.canvas, 0, 2,
+			 "Top printk emitters (count-min sketch, 1s / 10s windows):", 0x0F);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 3, heat_hdr, 0x08);
+
+	if (max_rows <= 0)
+		return;
+
+	n = vgadash_logheat_top(rows, min_t(int, LOGHEAT_TOPK, max_rows));
+	if (n == 0) {
+		vga_frame_puts_at(g_vgadash.canvas, 0, 5, "(no captured logs yet)", 0x07);
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		format_row(line, sizeof(line), &rows[i]);
+		vga_frame_puts_at(g_vgadash.canvas, 0, 4 + i, line,
+				 (rows[i].level <= 3) ? 0x0C : 0x07);
+	}
+}
+
+void page_heat_details(struct seq_file *m)
+{
+	struct logheat_row rows[LOGHEAT_TOPK];
+	char line[VGA_COLS + 1];
+	int n, i;
+
+	seq_puts(m, "Top printk emitters (count-min sketch, 1s / 10s windows):\n");
+	seq_printf(m, "%s\n", heat_hdr);
+
+	n = vgadash_logheat_top(rows, LOGHEAT_TOPK);
+	if (n == 0) {
+		seq_puts(m, "(no captured logs yet)\n");
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		format_row(line, sizeof(line), &rows[i]);
+		seq_printf(m, "%s\n", line);
+	}
+}
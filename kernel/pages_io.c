@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/seq_file.h>
+
+#include "vgadash.h"
+#include "vga_text.h"
+#include "iostats.h"
+#include "pages.h"
+
+#define IO_VGA_ROWS 9 /* per section */
+
+static const char disk_hdr[] =
+	"DISK               r/s      w/s    rKiB/s    wKiB/s  infl busy";
+static const char net_hdr[] =
+	"NETDEV           rxp/s    txp/s   rxKiB/s   txKiB/s  drop/s";
+
+static void format_row(char *line, size_t cap, const struct io_row *r)
+{
+	if (r->kind == IO_DISK)
+		snprintf(line, cap, "%-16.16s %6u %8u %9llu %9llu %5u %3u%%",
+			 r->name, r->rd_ops, r->wr_ops,
+			 (unsigned long long)(r->rd_bytes >> 10),
+			 (unsigned long long)(r->wr_bytes >> 10),
+			 r->inflight, r->busy_pct);
+	else
+		snprintf(line, cap, "%-16.16s %6u %8u %9llu %9llu %7u",
+			 r->name, r->rd_ops, r->wr_ops,
+			 (unsigned long long)(r->rd_bytes >> 10),
+			 (unsigned long long)(r->wr_bytes >> 10),
+			 r->drops);
+}
+
+static int render_section(enum io_kind kind, int y, const char *hdr)
+{
+	struct io_row rows[IO_VGA_ROWS];
+	char line[VGA_COLS + 1];
+	int n, i;
+
+	vga_frame_puts_at(g_vgadash.canvas, 0, y++, hdr, 0x0F);
+
+	n = vgadash_io_top(kind, rows, IO_VGA_ROWS);
+	if (n == 0)
+		vga_frame_puts_at(g_vgadash.canvas, 0, y++, "(none)", 0x08);
+
+	for (i = 0; i < n; i++) {
+		format_row(line, sizeof(line), &rows[i]);
+		vga_frame_puts_at(g_vgadash.canvas, 0, y++, line,
+				 (rows[i].busy_pct >= 90 || rows[i].drops) ? 0x0E : 0x07);
+	}
+
+	return y;
+}
+
+void page_io_render_vga(void)
+{
+	int y;
+
+	vga_frame_puts_at(g_vgadash.canvas, 0, 2, "I/O, busiest first (1 s deltas):", 0x0F);
+
+	y = render_section(IO_DISK, 3, disk_hdr);
+	render_section(IO_NET, y + 1, net_hdr);
+}
+
+static void snapshot_section(struct seq_file *m, enum io_kind kind, const char *hdr)
+{
+	struct io_row *rows;
+	char line[VGA_COLS + 1];
+	int n, i;
+
+	seq_printf(m, "%s\n", hdr);
+
+	rows = kmalloc_array(IO_MAX_DEVS, sizeof(*rows), GFP_KERNEL);
+	if (!rows) {
+		seq_puts(m, "io: kmalloc(rows) failed\n");
+		return;
+	}
+
+	n = vgadash_io_top(kind, rows, IO_MAX_DEVS);
+	if (n == 0)
+		seq_puts(m, "(none)\n");
+
+	for (i = 0; i < n; i++) {
+		format_row(line, sizeof(line), &rows[i]);
+		seq_printf(m, "%s\n", line);
+	}
+
+	kfree(rows);
+}
+
+void page_io_details(struct seq_file *m)
+{
+	seq_puts(m, "I/O, busiest first (1 s deltas):\n");
+	snapshot_section(m, IO_DISK, disk_hdr);
+	seq_puts(m, "\n");
+	snapshot_section(m, IO_NET, net_hdr);
+}
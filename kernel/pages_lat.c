@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/cpumask.h>
+#include <linux/seq_file.h>
+
+#include "vgadash.h"
+#include "vga_text.h"
+#include "latency.h"
+#include "pages.h"
+
+#define LAT_CELLS_PER_ROW 2
+#define LAT_WARN_NS       (100 * NSEC_PER_USEC)
+
+static const char lat_hdr[] = "CPU  cur(us)  max(us)  p99(us)";
+
+static void format_summary(char *line, size_t cap, const struct lat_summary *s)
+{
+	/* samples only grows: last, so a long count cannot push the rest off */
+	snprintf(line, cap,
+		 "period %uus  overhead %u.%03u%%  max %llu.%llu us  p99 <%llu.%llu us  samples %llu",
+		 s->period_us, s->overhead_ppm / 10000, s->overhead_ppm % 10000 / 10,
+		 (unsigned long long)(s->max_ns / 1000), (unsigned long long)(s->max_ns % 1000 / 100),
+		 (unsigned long long)(s->p99_ns / 1000), (unsigned long long)(s->p99_ns % 1000 / 100),
+		 (unsigned long long)s->samples);
+}
+
+static int format_cell(char *line, size_t cap, const struct lat_cpu_row *r)
+{
+	return scnprintf(line, cap, "%3d %6llu.%llu %6llu.%llu %6llu.%llu",
+			 r->cpu,
+			 (unsigned long long)(r->cur_ns / 1000), (unsigned long long)(r->cur_ns % 1000 / 100),
+			 (unsigned long long)(r->max_ns / 1000), (unsigned long long)(r->max_ns % 1000 / 100),
+			 (unsigned long long)(r->p99_ns / 1000), (unsigned long long)(r->p99_ns % 1000 / 100));
+}
+
+void page_lat_render_vga(void)
+{
+	struct lat_summary s;
+	struct lat_cpu_row *rows;
+	char line[VGA_COLS + 1];
+	int n, i, max_rows;
+
+	vgadash_lat_summary(&s);
+
+	vga_frame_puts_at(g_vgadash.canvas, 0, 2, "Timer wakeup latency per CPU (log2 histogram):", 0x0F);
+
+	if (!s.running) {
+		vga_frame_puts_at(g_vgadash.canvas, 0, 4, "(probe timers not armed)", 0x07);
+		return;
+	}
+
+	format_summary(line, sizeof(line), &s);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 3, line, 0x07);
+
+	for (i = 0; i < LAT_CELLS_PER_ROW; i++)
+		vga_frame_puts_at(g_vgadash.canvas, i * 40, 4, lat_hdr, 0x08);
+
+	max_rows = (g_vgadash.rows - 5) * LAT_CELLS_PER_ROW;
+	if (max_rows <= 0)
+		return;
+
+	rows = kmalloc_array(max_rows, sizeof(*rows), GFP_KERNEL);
+	if (!rows)
+		return;
+
+	n = vgadash_lat_cpus(rows, max_rows);
+	for (i = 0; i < n; i++) {
+		format_cell(line, sizeof(line), &rows[i]);
+		vga_frame_puts_at(g_vgadash.canvas, (i % LAT_CELLS_PER_ROW) * 40,
+				 5 + i / LAT_CELLS_PER_ROW, line,
+				 (rows[i].p99_ns > LAT_WARN_NS) ? 0x0E : 0x07);
+	}
+
+	kfree(rows);
+}
+
+void page_lat_details(struct seq_file *m)
+{
+	struct lat_summary s;
+	struct lat_cpu_row *rows;
+	char line[VGA_COLS + 1];
+	int n, i;
+
+	vgadash_lat_summary(&s);
+
+	seq_puts(m, "Timer wakeup latency per CPU (log2 histogram):\n");
+
+	if (!s.running) {
+		seq_puts(m, "(probe timers not armed)\n");
+		return;
+	}
+
+	format_summary(line, sizeof(line), &s);
+	seq_printf(m, "%s\n%s\n", line, lat_hdr);
+
+	rows = kmalloc_array(nr_cpu_ids, sizeof(*rows), GFP_KERNEL);
+	if (!rows)
+		return;
+
+	n = vgadash_lat_cpus(rows, nr_cpu_ids);
+	for (i = 0; i < n; i++) {
+		format_cell(line, sizeof(line), &rows[i]);
+		seq_printf(m, "%s\n", line);
+	}
+
+	kfree(rows);
+}
@@ -7,6 +7,7 @@
 #include "vga_text.h"
 #include "logtap.h"
 #include "pages.h"
+#include "rowcache.h"
 #include "util.h"
 
 #define SNAP_CAP (16 * 1024)
@@ -20,63 +21,383 @@ static void trim_and_print_seq(struct seq_file *m, char *line)
 	seq_printf(m, "%s\n", line);
 }
 
-void page_logs_render_vga(void)
+/*
+ * Scrollback. While following, the page shows the newest records; once
+ * scrolled it is anchored at a record (and wrapped row within it) and stays
+ * there as new records arrive. Records are fetched by sequence number, so
+ * moving costs a checkpoint seek in logtap, not a scan of the rings.
+ *
+ * An alert pins the record that raised it: the view is anchored a half
+ * screen above it and the record stays highlighted until the view is sent
+ * back to the bottom.
+ */
+struct logs_view {
+	bool follow;
+	bool wrap;
+	u64 seq;  /* top record while scrolled */
+	int sub;  /* wrapped row of that record on the top line */
+	int body; /* text lines at the last render */
+	u64 pin;  /* highlighted record, U64_MAX for none */
+};
+
+static struct logs_view view = {
+	.follow = true,
+	.wrap   = true,
+	.body   = VGA_ROWS - 3,
+	.pin    = U64_MAX,
+};
+
+static int fmt_ts(char *buf, size_t cap, u64 ts_usec)
 {
-	char *snap;
-	size_t n;
-	char (*lines)[81];
-	int i;
+	return scnprintf(buf, cap, "[%5llu.%06llu] ",
+			 (unsigned long long)(ts_usec / 1000000),
+			 (unsigned long long)(ts_usec % 1000000));
+}
 
-	const int max_lines = (VGA_ROWS - 3);
+/* Screen lines taken by one record */
+static int rec_rows(const struct logtap_rec *r)
+{
+	char ts[32];
+	int n = fmt_ts(ts, sizeof(ts), r->ts_usec) + r->len;
 
-	lines = kmalloc_array(max_lines, sizeof(*lines), GFP_KERNEL);
-	if (!lines) {
-		vga_text_puts_at(g_vgadash.vga_mem, 0, 2, "logs: kmalloc(lines) failed", 0x0F);
+	return view.wrap ? max(1, DIV_ROUND_UP(n, VGA_COLS)) : 1;
+}
+
+/* Wrapped row `sub` of "[ts] text", as 80 cells */
+static void format_rec_row(const struct logtap_rec *r, int sub, u16 *cells, bool pinned)
+{
+	char ts[32], line[VGA_COLS + 1];
+	int p = fmt_ts(ts, sizeof(ts), r->ts_usec);
+	int x, i;
+
+	for (x = 0; x < VGA_COLS; x++) {
+		i = sub * VGA_COLS + x;
+		if (i < p)
+			line[x] = ts[i];
+		else if (i - p < r->len)
+			line[x] = r->text[i - p];
+		else
+			break;
+	}
+	line[x] = '\0';
+	sanitize_line(line);
+
+	if (pinned) {
+		vga_frame_clear(cells, 0x4F, VGA_COLS);
+		vga_frame_puts_at(cells, 0, 0, line, 0x4F);
 		return;
 	}
+	vga_frame_clear(cells, 0x07, VGA_COLS);
+	vga_frame_puts_at(cells, 0, 0, line, (r->level <= 3) ? 0x0C : 0x07);
+}
 
-	snap = kmalloc(SNAP_CAP + 1, GFP_KERNEL);
-	if (!snap) {
-		vga_text_puts_at(g_vgadash.vga_mem, 0, 2, "logs: kmalloc(snap) failed", 0x0F);
-		kfree(lines);
+/*
+ * Rows already on screen come from the row cache; only a new record (or one
+ * pushed out of the cache) costs a text fetch and a formatting pass. The
+ * text buffer is shared, which is fine since all rows of a record are drawn
+ * before the next record. The pinned record is always drawn afresh, so its
+ * highlighted rows never end up in the cache.
+ */
+static struct rowcache log_rows;
+static char rec_text[LT_MSG_MAX];
+
+static bool fetch_text(struct logtap_rec *r)
+{
+	struct logtap_rec one;
+
+	if (!vgadash_logtap_read(g_vgadash.log_view, r->seq, false, &one, 1,
+				 rec_text, sizeof(rec_text)) || one.seq != r->seq)
+		return false;
+
+	r->text = one.text;
+	r->len = one.len;
+	return true;
+}
+
+static void draw_rec_row(struct logtap_rec *r, int sub, int y)
+{
+	u16 *row = g_vgadash.canvas + y * VGA_COLS;
+	const u16 *hit = NULL;
+	u64 key = ROWCACHE_KEY(r->seq, sub);
+	bool cache = sub <= ROWCACHE_MAX_SUB && r->seq != view.pin;
+
+	if (cache)
+		hit = rowcache_get(&log_rows, key);
+	if (hit) {
+		memcpy(row, hit, VGA_COLS * sizeof(u16));
 		return;
 	}
 
-	n = vgadash_logtap_snapshot(snap, SNAP_CAP);
-	snap[n] = '\0';
+	/* Gone from the rings since the headers were read: leave it blank */
+	if (!r->text && !fetch_text(r))
+		return;
 
-	vga_text_puts_at(g_vgadash.vga_mem, 0, 2,
-			 "Last console-emitted kernel log lines (post-load):", 0x0F);
+	format_rec_row(r, sub, row, r->seq == view.pin);
+	if (cache)
+		memcpy(rowcache_put(&log_rows, key), row, VGA_COLS * sizeof(u16));
+}
 
-	if (n == 0) {
-		vga_text_puts_at(g_vgadash.vga_mem, 0, 4, "(no captured logs yet)", 0x07);
-		kfree(snap);
-		kfree(lines);
+/* Top of the following view: the record and row `lines` rows above the end */
+static bool follow_top(int lines, u64 *seq, int *sub)
+{
+	struct logtap_rec *recs;
+	int n, i, rows = 0;
+
+	recs = kmalloc_array(lines, sizeof(*recs), GFP_KERNEL);
+	if (!recs)
+		return false;
+
+	n = vgadash_logtap_read(g_vgadash.log_view, U64_MAX, true, recs, lines, NULL, 0);
+	for (i = 0; i < n; i++) {
+		int r = rec_rows(&recs[i]);
+
+		if (rows + r >= lines) {
+			*seq = recs[i].seq;
+			*sub = rows + r - lines;
+			break;
+		}
+		rows += r;
+	}
+	if (i == n && n) {
+		*seq = recs[n - 1].seq;
+		*sub = 0;
+	}
+
+	kfree(recs);
+	return n > 0;
+}
+
+/* Follow again once the anchor is less than a screen from the end */
+static void check_bottom(void)
+{
+	struct logtap_rec *recs;
+	int n, i, rows = 0;
+
+	recs = kmalloc_array(view.body, sizeof(*recs), GFP_KERNEL);
+	if (!recs)
 		return;
+
+	n = vgadash_logtap_read(g_vgadash.log_view, view.seq, false, recs, view.body, NULL, 0);
+	for (i = 0; i < n; i++)
+		rows += rec_rows(&recs[i]) - (i == 0 && recs[0].seq == view.seq ? view.sub : 0);
+	if (rows <= view.body)
+		view.follow = true;
+
+	kfree(recs);
+}
+
+static void scroll_up(int lines)
+{
+	struct logtap_rec *recs;
+	int n, i;
+
+	if (view.follow) {
+		if (!follow_top(view.body, &view.seq, &view.sub))
+			return;
+		view.follow = false;
 	}
 
-	/* Extract last lines */
-	extract_last_lines(snap, (int)n, lines, max_lines, 80);
+	if (lines <= view.sub) {
+		view.sub -= lines;
+		return;
+	}
+	lines -= view.sub;
+	view.sub = 0;
 
-	/* Draw full area starting at y=3 */
-	for (i = 0; i < max_lines; i++) {
-		char tmp[81];
-		char *s;
+	recs = kmalloc_array(lines, sizeof(*recs), GFP_KERNEL);
+	if (!recs)
+		return;
 
-		memcpy(tmp, lines[i], 81);
-		tmp[80] = '\0';
+	n = vgadash_logtap_read(g_vgadash.log_view, view.seq, true, recs, lines, NULL, 0);
+	for (i = 0; i < n; i++) {
+		int r = rec_rows(&recs[i]);
 
-		s = strip_prio(tmp);
-		sanitize_line(s);
+		view.seq = recs[i].seq;
+		if (lines <= r) {
+			view.sub = r - lines;
+			break;
+		}
+		lines -= r;
+	}
+
+	kfree(recs);
+}
+
+static void scroll_down(int lines)
+{
+	struct logtap_rec *recs;
+	int n, i;
+
+	if (view.follow)
+		return;
+
+	recs = kmalloc_array(lines + 1, sizeof(*recs), GFP_KERNEL);
+	if (!recs)
+		return;
+
+	n = vgadash_logtap_read(g_vgadash.log_view, view.seq, false, recs, lines + 1, NULL, 0);
+	if (n && recs[0].seq != view.seq)
+		view.sub = 0;
 
-		vga_text_puts_at(g_vgadash.vga_mem, 0, 3 + i, s, 0x07);
+	for (i = 0; i < n; i++) {
+		int left = rec_rows(&recs[i]) - view.sub;
+
+		view.seq = recs[i].seq;
+		if (lines < left) {
+			view.sub += lines;
+			break;
+		}
+		lines -= left;
+		view.sub = 0;
 	}
+	if (i == n)
+		view.follow = true;
 
-	kfree(snap);
-	kfree(lines);
+	kfree(recs);
+	if (!view.follow)
+		check_bottom();
+}
+
+static void seek_seq(u64 seq)
+{
+	struct logtap_rec rec;
+
+	if (seq == U64_MAX ||
+	    !vgadash_logtap_read(g_vgadash.log_view, seq, false, &rec, 1, NULL, 0)) {
+		view.follow = true;
+		return;
+	}
+
+	view.follow = false;
+	view.seq = rec.seq;
+	view.sub = 0;
+	check_bottom();
+}
+
+static void pin_seq(u64 seq)
+{
+	/* Anchored on purpose: a flood must not scroll it away */
+	view.pin = seq;
+	view.follow = false;
+	view.seq = seq;
+	view.sub = 0;
+	scroll_up(view.body / 2);
+}
+
+void page_logs_scroll(enum logs_scroll op, u64 arg)
+{
+	switch (op) {
+	case LOGS_LINE_UP:
+		scroll_up(1);
+		break;
+	case LOGS_LINE_DOWN:
+		scroll_down(1);
+		break;
+	case LOGS_PAGE_UP:
+		scroll_up(max(1, view.body - 1));
+		break;
+	case LOGS_PAGE_DOWN:
+		scroll_down(max(1, view.body - 1));
+		break;
+	case LOGS_TOP:
+		seek_seq(0);
+		break;
+	case LOGS_BOTTOM:
+		view.follow = true;
+		view.pin = U64_MAX;
+		break;
+	case LOGS_SEQ:
+		seek_seq(arg);
+		break;
+	case LOGS_TIME:
+		seek_seq(vgadash_logtap_seq_at(g_vgadash.log_view, arg));
+		break;
+	case LOGS_WRAP:
+		view.wrap = arg;
+		break;
+	case LOGS_PIN:
+		pin_seq(arg);
+		break;
+	}
+}
+
+int page_logs_position(char *buf, size_t cap)
+{
+	int n;
+
+	if (view.follow)
+		n = scnprintf(buf, cap, "follow wrap=%d", view.wrap);
+	else
+		n = scnprintf(buf, cap, "seq=%llu+%d wrap=%d", view.seq, view.sub, view.wrap);
+	if (view.pin != U64_MAX)
+		n += scnprintf(buf + n, cap - n, " pin=%llu", view.pin);
+	return n;
+}
+
+void page_logs_render_vga(void)
+{
+	struct logtap_rec *recs;
+	char pos[64], view_str[32], title[VGA_COLS + 1];
+	int body, n, i, y, sub;
+
+	body = g_vgadash.rows - 3;
+	if (body <= 0)
+		return;
+	view.body = body;
+
+	vgadash_logtap_mask_str(g_vgadash.log_view, view_str, sizeof(view_str));
+	if (!view.follow && view.pin != U64_MAX) {
+		snprintf(title, sizeof(title), "Kernel log around alert, seq=%llu [%s] (bottom to follow):",
+			 view.pin, view_str);
+	} else if (view.follow) {
+		snprintf(title, sizeof(title), "Last captured kernel log lines [%s]:", view_str);
+	} else {
+		page_logs_position(pos, sizeof(pos));
+		snprintf(title, sizeof(title), "Kernel log from %s [%s] (scrolled):", pos, view_str);
+	}
+	vga_frame_puts_at(g_vgadash.canvas, 0, 2, title, 0x0F);
+
+	recs = kmalloc_array(body, sizeof(*recs), GFP_KERNEL);
+	if (!recs) {
+		vga_frame_puts_at(g_vgadash.canvas, 0, 3, "logs: kmalloc failed", 0x0F);
+		return;
+	}
+
+	/* Headers only; draw_rec_row() fetches text for rows not cached */
+	if (view.follow) {
+		/* Newest first; fill upwards from the bottom line */
+		n = vgadash_logtap_read(g_vgadash.log_view, U64_MAX, true, recs, body, NULL, 0);
+		y = 3 + body;
+		for (i = 0; i < n && y > 3; i++) {
+			for (sub = rec_rows(&recs[i]) - 1; sub >= 0 && y > 3; sub--)
+				draw_rec_row(&recs[i], sub, --y);
+		}
+		/* Short of a screen: move up to the title */
+		if (y > 3 && n) {
+			u16 *c = g_vgadash.canvas;
+
+			memmove(c + 3 * VGA_COLS, c + y * VGA_COLS, (3 + body - y) * VGA_COLS * sizeof(u16));
+			vga_frame_clear(c + (3 + body - (y - 3)) * VGA_COLS, 0x07, (y - 3) * VGA_COLS);
+		}
+	} else {
+		n = vgadash_logtap_read(g_vgadash.log_view, view.seq, false, recs, body, NULL, 0);
+		y = 3;
+		for (i = 0; i < n && y < 3 + body; i++) {
+			int rows = rec_rows(&recs[i]);
+
+			sub = (i == 0 && recs[0].seq == view.seq) ? min(view.sub, rows - 1) : 0;
+			for (; sub < rows && y < 3 + body; sub++)
+				draw_rec_row(&recs[i], sub, y++);
+		}
+	}
+
+	if (n == 0)
+		vga_frame_puts_at(g_vgadash.canvas, 0, 4, "(no captured logs yet)", 0x07);
+
+	kfree(recs);
 }
 
-void page_logs_snapshot(struct seq_file *m)
+void page_logs_details(struct seq_file *m)
 {
 	char *snap;
 	size_t n;
@@ -98,7 +419,7 @@ void page_logs_snapshot(struct seq_file *m)
 		return;
 	}
 
-	n = vgadash_logtap_snapshot(snap, SNAP_CAP);
+	n = vgadash_logtap_snapshot_mask(g_vgadash.log_view, snap, SNAP_CAP);
 	snap[n] = '\0';
 
 	if (n == 0) {
@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/cpumask.h>
+#include <linux/seq_file.h>
+#include <linux/sort.h>
+
+#include "vgadash.h"
+#include "vga_text.h"
+#include "oncpu.h"
+#include "pages.h"
+
+#define ONCPU_CELLS_PER_ROW 3
+#define ONCPU_CELL_COLS     26
+
+static const char oncpu_legend[] =
+	"ctx: u user  k kernel  K preempt/bh off  s softirq  i irq  - idle  ! no sample";
+static const char oncpu_hdr[] = "CPU    PID COMM             ST CTX   RUN(ms)  AGE(ms)";
+
+static const char ctx_chars[] = {
+	[ONCPU_IDLE]      = '-',
+	[ONCPU_USER]      = 'u',
+	[ONCPU_KERNEL]    = 'k',
+	[ONCPU_NOPREEMPT] = 'K',
+	[ONCPU_SOFTIRQ]   = 's',
+	[ONCPU_IRQ]       = 'i',
+};
+
+static char ctx_char(const struct oncpu_row *r)
+{
+	return r->stale ? '!' : ctx_chars[r->ctx];
+}
+
+static void format_summary(char *line, size_t cap, const struct oncpu_summary *s)
+{
+	snprintf(line, cap, "On CPU now (every %u ms): %d CPUs, %d idle, %d ran >= %u ms, %d stale",
+		 s->period_ms, s->cpus, s->idle, s->long_runs, s->long_ms, s->stale);
+}
+
+static void format_run(char *buf, size_t cap, u64 ns)
+{
+	u64 ms = ns / NSEC_PER_MSEC;
+
+	if (ms < 1000)
+		snprintf(buf, cap, "%4llums", (unsigned long long)ms);
+	else if (ms < 100 * 1000)
+		snprintf(buf, cap, "%3llu.%llus", (unsigned long long)(ms / 1000),
+			 (unsigned long long)(ms % 1000 / 100));
+	else
+		snprintf(buf, cap, "%5llus", (unsigned long long)min_t(u64, ms / 1000, 99999));
+}
+
+/* "  3 kworker/ R k  12.3s" */
+static void format_cell(char *line, size_t cap, const struct oncpu_row *r)
+{
+	char run[12];
+
+	if (r->ctx == ONCPU_IDLE && !r->stale) {
+		snprintf(line, cap, "%3d -", r->cpu);
+		return;
+	}
+
+	format_run(run, sizeof(run), r->run_ns);
+	snprintf(line, cap, "%3d %-8.8s %c %c %s", r->cpu, r->comm, r->state, ctx_char(r), run);
+}
+
+static u8 cell_attr(const struct oncpu_row *r)
+{
+	if (r->stale)
+		return 0x0C;
+	if (r->long_run)
+		return (r->ctx == ONCPU_USER || r->ctx == ONCPU_KERNEL) ? 0x0E : 0x0C;
+	if (r->ctx == ONCPU_IDLE)
+		return 0x08;
+	return 0x07;
+}
+
+static int cmp_run(const void *a, const void *b)
+{
+	const struct oncpu_row *ra = a, *rb = b;
+
+	if (ra->run_ns == rb->run_ns)
+		return ra->cpu - rb->cpu;
+	return (ra->run_ns > rb->run_ns) ? -1 : 1;
+}
+
+/*
+ * Make `n` rows fit `cells`: drop quiet idle CPUs first, then keep the
+ * longest runners. Returns the rows left.
+ */
+static int fit_rows(struct oncpu_row *rows, int n, int cells)
+{
+	int i, k = 0;
+
+	if (n <= cells)
+		return n;
+
+	for (i = 0; i < n; i++) {
+		if (rows[i].ctx != ONCPU_IDLE || rows[i].stale)
+			rows[k++] = rows[i];
+	}
+	if (k > cells) {
+		sort(rows, k, sizeof(*rows), cmp_run, NULL);
+		k = cells;
+	}
+	return k;
+}
+
+void page_oncpu_render_vga(void)
+{
+	struct oncpu_summary s;
+	struct oncpu_row *rows;
+	char line[VGA_COLS + 1];
+	int n, shown, cells, i;
+
+	rows = kmalloc_array(nr_cpu_ids, sizeof(*rows), GFP_KERNEL);
+	if (!rows) {
+		vga_frame_puts_at(g_vgadash.canvas, 0, 2, "oncpu: kmalloc(rows) failed", 0x0F);
+		return;
+	}
+
+	n = vgadash_oncpu_read(rows, nr_cpu_ids, &s);
+	if (!s.running) {
+		vga_frame_puts_at(g_vgadash.canvas, 0, 2, "On CPU now:", 0x0F);
+		vga_frame_puts_at(g_vgadash.canvas, 0, 4, "(sampling timers not armed)", 0x07);
+		goto out;
+	}
+
+	format_summary(line, sizeof(line), &s);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 2, line, 0x0F);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 3, oncpu_legend, 0x08);
+
+	cells = (g_vgadash.rows - 4) * ONCPU_CELLS_PER_ROW;
+	if (cells <= 0)
+		goto out;
+
+	shown = fit_rows(rows, n, cells);
+	if (shown < n) {
+		/* Keep the last cell for the count of what did not fit */
+		shown = min(shown, cells - 1);
+		snprintf(line, sizeof(line), "+%d more", n - shown);
+		vga_frame_puts_at(g_vgadash.canvas,
+				 ((cells - 1) % ONCPU_CELLS_PER_ROW) * ONCPU_CELL_COLS,
+				 4 + (cells - 1) / ONCPU_CELLS_PER_ROW, line, 0x08);
+	}
+
+	for (i = 0; i < shown; i++) {
+		format_cell(line, sizeof(line), &rows[i]);
+		vga_frame_puts_at(g_vgadash.canvas, (i % ONCPU_CELLS_PER_ROW) * ONCPU_CELL_COLS,
+				 4 + i / ONCPU_CELLS_PER_ROW, line, cell_attr(&rows[i]));
+	}
+out:
+	kfree(rows);
+}
+
+void page_oncpu_details(struct seq_file *m)
+{
+	struct oncpu_summary s;
+	struct oncpu_row *rows;
+	char line[VGA_COLS + 1];
+	int n, i;
+
+	rows = kmalloc_array(nr_cpu_ids, sizeof(*rows), GFP_KERNEL);
+	if (!rows) {
+		seq_puts(m, "oncpu: kmalloc(rows) failed\n");
+		return;
+	}
+
+	n = vgadash_oncpu_read(rows, nr_cpu_ids, &s);
+	if (!s.running) {
+		seq_puts(m, "On CPU now:\n(sampling timers not armed)\n");
+		goto out;
+	}
+
+	format_summary(line, sizeof(line), &s);
+	seq_printf(m, "%s\n%s\n%s\n", line, oncpu_legend, oncpu_hdr);
+
+	for (i = 0; i < n; i++) {
+		const struct oncpu_row *r = &rows[i];
+
+		seq_printf(m, "%3d %6d %-16s %c  %c   %9llu %8llu%s\n",
+			   r->cpu, r->pid, r->comm, r->state, ctx_char(r),
+			   (unsigned long long)(r->run_ns / NSEC_PER_MSEC),
+			   (unsigned long long)(r->age_ns / NSEC_PER_MSEC),
+			   r->long_run ? "  long" : "");
+	}
+out:
+	kfree(rows);
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/seq_file.h>
+
+#include "vgadash.h"
+#include "vga_text.h"
+#include "logtap.h"
+#include "pages.h"
+#include "util.h"
+
+#define PREV_SNAP_CAP (16 * 1024)
+
+static void format_title(char *line, size_t cap, const struct logtap_prev_info *pi)
+{
+	time64_t start = pi->start_real;
+
+	snprintf(line, cap, "Previous boot #%llu (from %ptT): %u records, %u torn",
+		 pi->boot, &start, pi->records, pi->torn);
+}
+
+void page_prev_render_vga(void)
+{
+	struct logtap_prev_info pi;
+	char line[VGA_COLS + 1];
+	char (*lines)[81];
+	char *snap;
+	size_t n;
+	int i, got;
+
+	const int max_lines = g_vgadash.rows - 3;
+
+	vgadash_logtap_prev_info(&pi);
+	if (!pi.valid) {
+		snprintf(line, sizeof(line), "Previous boot: %s", pi.why);
+		vga_frame_puts_at(g_vgadash.canvas, 0, 2, line, 0x0F);
+		return;
+	}
+
+	format_title(line, sizeof(line), &pi);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 2, line, 0x0F);
+
+	if (max_lines <= 0)
+		return;
+
+	lines = kmalloc_array(max_lines, sizeof(*lines), GFP_KERNEL);
+	snap = kmalloc(PREV_SNAP_CAP, GFP_KERNEL);
+	if (!lines || !snap) {
+		vga_frame_puts_at(g_vgadash.canvas, 0, 3, "prev: kmalloc failed", 0x0F);
+		goto out;
+	}
+
+	n = vgadash_logtap_prev_snapshot(snap, PREV_SNAP_CAP);
+	got = extract_last_lines(snap, (int)n, lines, max_lines, 80);
+
+	/* extract_last_lines() fills from the bottom */
+	for (i = max_lines - got; i < max_lines; i++) {
+		sanitize_line(lines[i]);
+		vga_frame_puts_at(g_vgadash.canvas, 0, 3 + i, lines[i], 0x07);
+	}
+out:
+	kfree(snap);
+	kfree(lines);
+}
+
+void page_prev_details(struct seq_file *m)
+{
+	struct logtap_prev_info pi;
+	char line[VGA_COLS + 1];
+
+	vgadash_logtap_prev_info(&pi);
+	if (!pi.valid) {
+		seq_printf(m, "Previous boot: %s\n", pi.why);
+		return;
+	}
+
+	format_title(line, sizeof(line), &pi);
+	seq_printf(m, "%s\n", line);
+	vgadash_logtap_prev_show(m);
+}
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/cpumask.h>
+#include <linux/seq_file.h>
+
+#include "vgadash.h"
+#include "vga_text.h"
+#include "tpstats.h"
+#include "pages.h"
+
+#define CPUS_PER_ROW 5
+
+static void format_totals(char *line, size_t cap, const struct tp_rates *r)
+{
+	snprintf(line, cap, "ctxsw/s %-9llu wakeups/s %-9llu irqs/s %-9llu syscalls/s %llu",
+		 (unsigned long long)r->ctxsw, (unsigned long long)r->wakeups,
+		 (unsigned long long)r->irqs, (unsigned long long)r->syscalls);
+}
+
+/* Up to CPUS_PER_ROW "cpuN rate" cells starting at `first`; returns CPUs used */
+static int format_cpu_row(char *line, size_t cap, const u32 *rates, int n, int first)
+{
+	int len = 0, i;
+
+	line[0] = '\0';
+	for (i = first; i < n && i < first + CPUS_PER_ROW; i++)
+		len += scnprintf(line + len, cap - len, "cpu%-3d %-6u ", i, rates[i]);
+
+	return i - first;
+}
+
+void page_sched_render_vga(void)
+{
+	struct tp_rates r;
+	char line[VGA_COLS + 1];
+	u32 *rates;
+	int i, n, y;
+
+	vgadash_tp_rates(&r);
+
+	vga_frame_puts_at(g_vgadash.canvas, 0, 2,
+			 "Scheduler / IRQ / syscall rates (tracepoints):", 0x0F);
+
+	if (!r.running) {
+		vga_frame_puts_at(g_vgadash.canvas, 0, 4,
+				 "(probes not attached; load with tracepoints=1)", 0x07);
+		return;
+	}
+	if (!r.valid) {
+		vga_frame_puts_at(g_vgadash.canvas, 0, 4, "(sampling...)", 0x07);
+		return;
+	}
+
+	format_totals(line, sizeof(line), &r);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 3, line, 0x07);
+
+	vga_frame_puts_at(g_vgadash.canvas, 0, 5, "Top syscalls (nr calls/s):", 0x0F);
+	for (i = 0; i < r.nr_top; i++) {
+		snprintf(line, sizeof(line), "%4d %-10u", r.top[i].nr, r.top[i].rate);
+		vga_frame_puts_at(g_vgadash.canvas, (i % 4) * 20, 6 + i / 4, line, 0x07);
+	}
+
+	vga_frame_puts_at(g_vgadash.canvas, 0, 9, "Context switches/s per CPU:", 0x0F);
+
+	rates = kmalloc_array(nr_cpu_ids, sizeof(*rates), GFP_KERNEL);
+	if (!rates)
+		return;
+
+	n = vgadash_tp_cpu_ctxsw(rates, nr_cpu_ids);
+	for (i = 0, y = 10; i < n && y < g_vgadash.rows; y++) {
+		if (y == g_vgadash.rows - 1 && n - i > CPUS_PER_ROW) {
+			snprintf(line, sizeof(line), "(+%d more CPUs, see details)", n - i);
+			vga_frame_puts_at(g_vgadash.canvas, 0, y, line, 0x08);
+			break;
+		}
+		i += format_cpu_row(line, sizeof(line), rates, n, i);
+		vga_frame_puts_at(g_vgadash.canvas, 0, y, line, 0x07);
+	}
+
+	kfree(rates);
+}
+
+void page_sched_details(struct seq_file *m)
+{
+	struct tp_rates r;
+	char line[VGA_COLS + 1];
+	u32 *rates;
+	int i, n;
+
+	vgadash_tp_rates(&r);
+
+	seq_puts(m, "Scheduler / IRQ / syscall rates (tracepoints):\n");
+
+	if (!r.running) {
+		seq_puts(m, "(probes not attached; load with tracepoints=1)\n");
+		return;
+	}
+	if (!r.valid) {
+		seq_puts(m, "(sampling...)\n");
+		return;
+	}
+
+	format_totals(line, sizeof(line), &r);
+	seq_printf(m, "%s\n", line);
+
+	seq_puts(m, "Top syscalls (nr calls/s):\n");
+	for (i = 0; i < r.nr_top; i++)
+		seq_printf(m, "%4d %u\n", r.top[i].nr, r.top[i].rate);
+
+	seq_puts(m, "Context switches/s per CPU:\n");
+
+	rates = kmalloc_array(nr_cpu_ids, sizeof(*rates), GFP_KERNEL);
+	if (!rates)
+		return;
+
+	n = vgadash_tp_cpu_ctxsw(rates, nr_cpu_ids);
+	for (i = 0; i < n; ) {
+		i += format_cpu_row(line, sizeof(line), rates, n, i);
+		seq_printf(m, "%s\n", line);
+	}
+
+	kfree(rates);
+}
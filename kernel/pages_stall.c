@@ -0,0 +1,192 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/cpumask.h>
+#include <linux/seq_file.h>
+
+#include "vgadash.h"
+#include "vga_text.h"
+#include "heartbeat.h"
+#include "pages.h"
+
+#define HB_MAP_COLS  64 /* CPUs per map row */
+#define HB_LIST_ROWS 4  /* stalled-now lines on screen */
+
+static const char hb_legend[] =
+	"CPU map: . ok  P no reschedule  I irqs off  * stalled in the last minute";
+static const char hb_hdr[] = "CPU  irq(ms)  task(ms)  max irq(ms)  max task(ms)  stalls";
+static const char hb_top_hdr[] = "CPU  kind        length(ms)  ended(s ago)";
+
+static const char *const hb_kind_names[] = {
+	[HB_OK]      = "ok",
+	[HB_PREEMPT] = "no resched",
+	[HB_IRQ]     = "irqs off",
+};
+
+/* Two lines: the settings, then the counts, so neither runs past a row */
+static void format_settings(char *line, size_t cap, const struct hb_summary *s)
+{
+	snprintf(line, cap, "Heartbeat %u ms, stall >= %u ms", s->period_ms, s->stall_ms);
+}
+
+static void format_counts(char *line, size_t cap, const struct hb_summary *s)
+{
+	snprintf(line, cap, "%d CPUs, %d irqs off, %d no resched, %llu stalls",
+		 s->cpus, s->irq_stalled, s->preempt_stalled, (unsigned long long)s->stalls);
+}
+
+static char map_char(const struct hb_cpu_row *r)
+{
+	if (r->state == HB_IRQ)
+		return 'I';
+	if (r->state == HB_PREEMPT)
+		return 'P';
+	return r->recent ? '*' : '.';
+}
+
+static void format_cpu(char *line, size_t cap, const struct hb_cpu_row *r)
+{
+	snprintf(line, cap, "%3d %8llu %9llu %12llu %13llu %7u",
+		 r->cpu,
+		 (unsigned long long)(r->irq_age_ns / NSEC_PER_MSEC),
+		 (unsigned long long)(r->has_task ? r->task_age_ns / NSEC_PER_MSEC : 0),
+		 (unsigned long long)(r->irq_max_ns / NSEC_PER_MSEC),
+		 (unsigned long long)(r->task_max_ns / NSEC_PER_MSEC),
+		 r->stalls);
+}
+
+static void format_stall(char *line, size_t cap, const struct hb_stall *st)
+{
+	snprintf(line, cap, "%3d  %-10s  %10llu  %12llu",
+		 st->cpu, hb_kind_names[st->kind],
+		 (unsigned long long)(st->len_ns / NSEC_PER_MSEC),
+		 (unsigned long long)(st->ago_ns / NSEC_PER_SEC));
+}
+
+/* One character per CPU, HB_MAP_COLS to a row; returns the next free row */
+static int draw_map(const struct hb_cpu_row *rows, int n, int y, int last)
+{
+	char label[8], c[2] = { 0 };
+	int i;
+
+	for (i = 0; i < n; i++) {
+		int col = i % HB_MAP_COLS;
+		u8 attr;
+
+		if (col == 0) {
+			if (y > last)
+				break;
+			snprintf(label, sizeof(label), "%4d", rows[i].cpu);
+			vga_frame_puts_at(g_vgadash.canvas, 0, y, label, 0x08);
+		}
+
+		c[0] = map_char(&rows[i]);
+		attr = rows[i].state != HB_OK ? 0x0C : (rows[i].recent ? 0x0E : 0x07);
+		vga_frame_puts_at(g_vgadash.canvas, 5 + col, y, c, attr);
+
+		if (col == HB_MAP_COLS - 1 || i == n - 1)
+			y++;
+	}
+	return y;
+}
+
+void page_stall_render_vga(void)
+{
+	struct hb_summary s;
+	struct hb_cpu_row *rows;
+	struct hb_stall top[HB_TOP];
+	char line[VGA_COLS + 1];
+	int n, nt, i, y, shown;
+
+	const int last = g_vgadash.rows - 1;
+
+	rows = kmalloc_array(nr_cpu_ids, sizeof(*rows), GFP_KERNEL);
+	if (!rows) {
+		vga_frame_puts_at(g_vgadash.canvas, 0, 2, "stall: kmalloc(rows) failed", 0x0F);
+		return;
+	}
+
+	n = vgadash_hb_cpus(rows, nr_cpu_ids, &s);
+	if (!s.running) {
+		vga_frame_puts_at(g_vgadash.canvas, 0, 2, "Heartbeats:", 0x0F);
+		vga_frame_puts_at(g_vgadash.canvas, 0, 4, "(heartbeats not running)", 0x07);
+		goto out;
+	}
+
+	format_settings(line, sizeof(line), &s);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 2, line, 0x0F);
+	format_counts(line, sizeof(line), &s);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 3, line,
+			 (s.irq_stalled || s.preempt_stalled) ? 0x0C : 0x0F);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 4, hb_legend, 0x08);
+
+	y = draw_map(rows, n, 5, last);
+
+	/* CPUs stalled right now, with how long they have been silent */
+	for (i = 0, shown = 0; i < n && shown < HB_LIST_ROWS; i++) {
+		if (rows[i].state == HB_OK)
+			continue;
+		if (!shown++) {
+			y++;
+			if (y > last)
+				break;
+			vga_frame_puts_at(g_vgadash.canvas, 0, y++, hb_hdr, 0x08);
+		}
+		if (y > last)
+			break;
+		format_cpu(line, sizeof(line), &rows[i]);
+		vga_frame_puts_at(g_vgadash.canvas, 0, y++, line, 0x0C);
+	}
+
+	y++;
+	if (y > last)
+		goto out;
+	nt = vgadash_hb_top(top, HB_TOP);
+	vga_frame_puts_at(g_vgadash.canvas, 0, y, "Longest stalls:", 0x0F);
+	vga_frame_puts_at(g_vgadash.canvas, 16, y++, nt ? hb_top_hdr : "(none)", 0x08);
+	for (i = 0; i < nt && y <= last; i++) {
+		format_stall(line, sizeof(line), &top[i]);
+		vga_frame_puts_at(g_vgadash.canvas, 16, y++, line, 0x07);
+	}
+out:
+	kfree(rows);
+}
+
+void page_stall_details(struct seq_file *m)
+{
+	struct hb_summary s;
+	struct hb_cpu_row *rows;
+	struct hb_stall top[HB_TOP];
+	char line[VGA_COLS + 1];
+	int n, nt, i;
+
+	rows = kmalloc_array(nr_cpu_ids, sizeof(*rows), GFP_KERNEL);
+	if (!rows) {
+		seq_puts(m, "stall: kmalloc(rows) failed\n");
+		return;
+	}
+
+	n = vgadash_hb_cpus(rows, nr_cpu_ids, &s);
+	if (!s.running) {
+		seq_puts(m, "Heartbeats:\n(heartbeats not running)\n");
+		goto out;
+	}
+
+	format_settings(line, sizeof(line), &s);
+	seq_printf(m, "%s\n", line);
+	format_counts(line, sizeof(line), &s);
+	seq_printf(m, "%s\n%s\n", line, hb_hdr);
+	for (i = 0; i < n; i++) {
+		format_cpu(line, sizeof(line), &rows[i]);
+		seq_printf(m, "%s  %s\n", line, hb_kind_names[rows[i].state]);
+	}
+
+	nt = vgadash_hb_top(top, HB_TOP);
+	seq_printf(m, "\nLongest stalls:\n%s\n", hb_top_hdr);
+	for (i = 0; i < nt; i++) {
+		format_stall(line, sizeof(line), &top[i]);
+		seq_printf(m, "%s\n", line);
+	}
+out:
+	kfree(rows);
+}
@@ -1,63 +1,114 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <linux/kernel.h>
-#include <linux/ktime.h>
-#include <linux/smp.h>
-#include <linux/sysinfo.h>
-#include <linux/mm.h>
+#include <linux/sched/loadavg.h>
 #include <linux/seq_file.h>
 #include <generated/utsrelease.h>
 
 #include "vgadash.h"
 #include "vga_text.h"
+#include "sampler.h"
 #include "pages.h"
 
+#define SPARK_WIDTH 52
+
+/* "<metric> <res> <sparkline> <latest value>" */
+static void format_trend(char *line, size_t cap, enum sampler_metric m, enum sampler_res r)
+{
+	char spark[SPARK_WIDTH + 1];
+	u32 v[1];
+	int n;
+
+	vgadash_sampler_sparkline(m, r, spark, SPARK_WIDTH);
+	n = vgadash_sampler_series(m, r, v, 1);
+
+	snprintf(line, cap, "%-12s %-3s %s %u.%02u",
+		 vgadash_sampler_metric_name(m), vgadash_sampler_res_name(r), spark,
+		 n ? v[0] >> SERIES_FRAC : 0,
+		 n ? ((v[0] & (SERIES_ONE - 1)) * 100) >> SERIES_FRAC : 0);
+}
+
+static void format_load(char *line, size_t cap, const struct sampler_snap *s)
+{
+	snprintf(line, cap, "Load: %lu.%02lu %lu.%02lu %lu.%02lu  Log: %u rec/s",
+		 LOAD_INT(s->load[0]), LOAD_FRAC(s->load[0]),
+		 LOAD_INT(s->load[1]), LOAD_FRAC(s->load[1]),
+		 LOAD_INT(s->load[2]), LOAD_FRAC(s->load[2]),
+		 s->log_rate);
+}
+
 void page_state_render_vga(void)
 {
-	u64 up = ktime_get_boottime_seconds();
-	struct sysinfo si;
-	u64 total_mib, free_mib;
+	struct sampler_snap s;
 	char line[80];
+	int len, i, y;
+	enum sampler_metric m;
+	enum sampler_res r;
 
-	si_meminfo(&si);
-	total_mib = (u64)si.totalram * si.mem_unit / (1024ULL * 1024ULL);
-	free_mib  = (u64)si.freeram  * si.mem_unit / (1024ULL * 1024ULL);
+	vgadash_sampler_latest(&s);
 
 	snprintf(line, sizeof(line), "Kernel: %s", UTS_RELEASE);
-	vga_text_puts_at(g_vgadash.vga_mem, 0, 2, line, 0x07);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 2, line, 0x07);
 
-	snprintf(line, sizeof(line), "Uptime: %llu s", (unsigned long long)up);
-	vga_text_puts_at(g_vgadash.vga_mem, 0, 3, line, 0x07);
+	snprintf(line, sizeof(line), "Uptime: %llu s", (unsigned long long)s.uptime_s);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 3, line, 0x07);
 
-	snprintf(line, sizeof(line), "CPUs online: %u", num_online_cpus());
-	vga_text_puts_at(g_vgadash.vga_mem, 0, 4, line, 0x07);
+	snprintf(line, sizeof(line), "CPUs online: %u", s.cpus_online);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 4, line, 0x07);
 
 	snprintf(line, sizeof(line), "Mem: total %llu MiB  free %llu MiB",
-		 (unsigned long long)total_mib, (unsigned long long)free_mib);
-	vga_text_puts_at(g_vgadash.vga_mem, 0, 5, line, 0x07);
+		 (unsigned long long)s.mem_total_mib, (unsigned long long)s.mem_free_mib);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 5, line, 0x07);
+
+	format_load(line, sizeof(line), &s);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 6, line, 0x07);
+
+	snprintf(line, sizeof(line), "Tasks on each CPU: %s page",
+		 vgadash_page_name(VGADASH_PAGE_ONCPU));
+	vga_frame_puts_at(g_vgadash.canvas, 0, 7, line, 0x07);
 
-	snprintf(line, sizeof(line), "This CPU task: pid=%d comm=%s", current->pid, current->comm);
-	vga_text_puts_at(g_vgadash.vga_mem, 0, 7, line, 0x07);
+	vga_frame_puts_at(g_vgadash.canvas, 0, 9, "Controls:", 0x0F);
+	vga_frame_puts_at(g_vgadash.canvas, 2, 10, "echo 1 > /sys/kernel/debug/vgadash/toggle", 0x07);
+	vga_frame_puts_at(g_vgadash.canvas, 2, 11, "echo <page> > /sys/kernel/debug/vgadash/page", 0x07);
+	vga_frame_puts_at(g_vgadash.canvas, 2, 12, "cat /sys/kernel/debug/vgadash/snapshot", 0x07);
 
-	vga_text_puts_at(g_vgadash.vga_mem, 0, 9, "Controls:", 0x0F);
-	vga_text_puts_at(g_vgadash.vga_mem, 2, 10, "echo 1 > /sys/kernel/debug/vgadash/toggle", 0x07);
-	vga_text_puts_at(g_vgadash.vga_mem, 2, 11, "echo logs|state > /sys/kernel/debug/vgadash/page", 0x07);
-	vga_text_puts_at(g_vgadash.vga_mem, 2, 12, "cat /sys/kernel/debug/vgadash/snapshot", 0x07);
+	len = scnprintf(line, sizeof(line), "Pages:");
+	for (i = 0; i < VGADASH_NR_PAGES; i++)
+		len += scnprintf(line + len, sizeof(line) - len, " %s", vgadash_page_name(i));
+	vga_frame_puts_at(g_vgadash.canvas, 2, 13, line, 0x07);
+
+	vga_frame_puts_at(g_vgadash.canvas, 0, 15, "Trends (newest on the right):", 0x0F);
+	y = 16;
+	for (r = 0; r < SR_NR_RES; r++) {
+		for (m = 0; m < SM_NR_METRICS && y < g_vgadash.rows; m++, y++) {
+			format_trend(line, sizeof(line), m, r);
+			vga_frame_puts_at(g_vgadash.canvas, 0, y, line, 0x07);
+		}
+	}
 }
 
-void page_state_snapshot(struct seq_file *m)
+void page_state_details(struct seq_file *m)
 {
-	u64 up = ktime_get_boottime_seconds();
-	struct sysinfo si;
-	u64 total_mib, free_mib;
+	struct sampler_snap s;
+	char line[80];
+	enum sampler_metric mi;
+	enum sampler_res r;
 
-	si_meminfo(&si);
-	total_mib = (u64)si.totalram * si.mem_unit / (1024ULL * 1024ULL);
-	free_mib  = (u64)si.freeram  * si.mem_unit / (1024ULL * 1024ULL);
+	vgadash_sampler_latest(&s);
 
 	seq_printf(m, "Kernel: %s\n", UTS_RELEASE);
-	seq_printf(m, "Uptime: %llu s\n", (unsigned long long)up);
-	seq_printf(m, "CPUs online: %u\n", num_online_cpus());
+	seq_printf(m, "Uptime: %llu s\n", (unsigned long long)s.uptime_s);
+	seq_printf(m, "CPUs online: %u\n", s.cpus_online);
 	seq_printf(m, "Mem: total %llu MiB  free %llu MiB\n",
-		   (unsigned long long)total_mib, (unsigned long long)free_mib);
-	seq_printf(m, "This CPU task: pid=%d comm=%s\n", current->pid, current->comm);
+		   (unsigned long long)s.mem_total_mib, (unsigned long long)s.mem_free_mib);
+	format_load(line, sizeof(line), &s);
+	seq_printf(m, "%s\n", line);
+	seq_printf(m, "Tasks on each CPU: %s page\n", vgadash_page_name(VGADASH_PAGE_ONCPU));
+
+	seq_puts(m, "Trends (newest on the right):\n");
+	for (r = 0; r < SR_NR_RES; r++) {
+		for (mi = 0; mi < SM_NR_METRICS; mi++) {
+			format_trend(line, sizeof(line), mi, r);
+			seq_printf(m, "%s\n", line);
+		}
+	}
 }
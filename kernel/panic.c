@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Panic / oops painter.
+ *
+ * On panic or oops the tail of the capture ring is painted straight into VGA
+ * memory. Nothing here sleeps, allocates, queues work or spins on a lock: the
+ * ring is read with a trylock (or without the lock), the buffers are static,
+ * and painting stops once panic_budget_us has elapsed so the reboot (or a
+ * kdump with crash_kexec_post_notifiers) is not held up. Without that option
+ * crash_kexec() runs before the panic notifiers and there is no panic paint.
+ *
+ * The paint belongs to no backend and does not switch the dashboard on; it
+ * sets g_vgadash.emergency instead, and the render owner stops drawing so
+ * the paint stays up after a survivable oops. Switching the dashboard on or
+ * off takes the screen back and lets the next oops paint again. Built in, the same painter
+ * shows the log tail during early boot, before anything else of the
+ * dashboard can run.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/atomic.h>
+#include <linux/kdebug.h>
+#include <linux/notifier.h>
+#include <linux/panic_notifier.h>
+#include <linux/timekeeping.h>
+
+#include "vgadash.h"
+#include "vga_text.h"
+#include "logtap.h"
+#include "util.h"
+#include "panic.h"
+
+#define PANIC_SNAP_CAP (8 * 1024)
+#define PANIC_MAX_LINES (VGA_ROWS - 2)
+
+static bool panic_paint = true;
+module_param(panic_paint, bool, 0444);
+MODULE_PARM_DESC(panic_paint, "Paint the captured log tail on panic/oops");
+
+static unsigned int panic_lines = PANIC_MAX_LINES;
+module_param(panic_lines, uint, 0644);
+MODULE_PARM_DESC(panic_lines, "Log lines painted on panic/oops");
+
+static unsigned int panic_budget_us = 2000;
+module_param(panic_budget_us, uint, 0644);
+MODULE_PARM_DESC(panic_budget_us, "Time budget for the panic/oops paint");
+
+static char panic_snap[PANIC_SNAP_CAP + 1];
+static char panic_rows[PANIC_MAX_LINES][81];
+static atomic_t oops_painted = ATOMIC_INIT(0);
+static atomic_t panic_painted = ATOMIC_INIT(0);
+static atomic_t paint_busy = ATOMIC_INIT(0); /* early paints only */
+
+static void paint_tail(void __iomem *vga, const char *why, u8 attr)
+{
+	u64 t0 = ktime_get_mono_fast_ns();
+	u64 budget = (u64)panic_budget_us * NSEC_PER_USEC;
+	char hdr[VGA_COLS + 1];
+	size_t n;
+	int rows, cnt, i;
+
+	n = vgadash_logtap_snapshot_atomic(panic_snap, PANIC_SNAP_CAP);
+	panic_snap[n] = '\0';
+
+	vga_text_clear(vga, 0x07, VGA_CELLS);
+	snprintf(hdr, sizeof(hdr), " VGADASH  *** %s ***  last captured console lines", why);
+	vga_text_puts_at(vga, 0, 0, hdr, attr);
+	vga_text_puts_at(vga, 0, 1,
+			 "--------------------------------------------------------------------------------", 0x08);
+
+	rows = min_t(int, panic_lines, PANIC_MAX_LINES);
+	if (rows <= 0 || n == 0)
+		return;
+
+	cnt = extract_last_lines(panic_snap, (int)n, panic_rows, rows, 80);
+
+	/* extract_last_lines() fills from the bottom; draw only filled rows */
+	for (i = rows - cnt; i < rows; i++) {
+		char *s;
+
+		if (ktime_get_mono_fast_ns() - t0 > budget)
+			break;
+
+		s = strip_prio(panic_rows[i]);
+		sanitize_line(s);
+		vga_text_puts_at(vga, 0, 2 + i - (rows - cnt), s, 0x07);
+	}
+}
+
+static void paint_emergency(const char *why)
+{
+	void __iomem *vga = g_vgadash.vga_mem;
+	u8 cur_start, cur_end;
+	bool cur_saved;
+
+	if (!vga)
+		return;
+
+	/* Lock-free on purpose: the render owner checks it before every frame */
+	WRITE_ONCE(g_vgadash.emergency, true);
+	vga_cursor_save_and_disable(&cur_start, &cur_end, &cur_saved);
+
+	/* Does not wait for an early paint: the buffers are only scratch */
+	paint_tail(vga, why, 0x4F);
+}
+
+void vgadash_panic_paint_tail(const char *why)
+{
+	void __iomem *vga = READ_ONCE(g_vgadash.vga_mem);
+
+	if (!vga || atomic_xchg(&paint_busy, 1))
+		return;
+	paint_tail(vga, why, 0x1F);
+	atomic_set(&paint_busy, 0);
+}
+
+void vgadash_panic_release(void)
+{
+	WRITE_ONCE(g_vgadash.emergency, false);
+	atomic_set(&oops_painted, 0);
+}
+
+static int vgadash_panic_event(struct notifier_block *nb, unsigned long event, void *ptr)
+{
+	if (!atomic_xchg(&panic_painted, 1))
+		paint_emergency("KERNEL PANIC");
+	return NOTIFY_DONE;
+}
+
+static int vgadash_die_event(struct notifier_block *nb, unsigned long event, void *ptr)
+{
+	if (event == DIE_OOPS && !atomic_xchg(&oops_painted, 1))
+		paint_emergency("OOPS");
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block panic_nb = {
+	.notifier_call = vgadash_panic_event,
+	.priority = INT_MAX, /* before the other notifiers; reboot follows them */
+};
+
+static struct notifier_block die_nb = {
+	.notifier_call = vgadash_die_event,
+};
+
+int vgadash_panic_init(void)
+{
+	int ret;
+
+	if (!panic_paint)
+		return 0;
+
+	/* The panic path cannot ioremap; map VGA memory up front */
+	ret = vga_text_ensure_mapped(&g_vgadash.vga_mem);
+	if (ret)
+		return ret;
+
+	atomic_notifier_chain_register(&panic_notifier_list, &panic_nb);
+	register_die_notifier(&die_nb);
+	return 0;
+}
+
+void vgadash_panic_exit(void)
+{
+	if (!panic_paint)
+		return;
+
+	unregister_die_notifier(&die_nb);
+	atomic_notifier_chain_unregister(&panic_notifier_list, &panic_nb);
+}
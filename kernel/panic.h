@@ -0,0 +1,14 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _VGADASH_PANIC_H_
+#define _VGADASH_PANIC_H_
+
+int  vgadash_panic_init(void);
+void vgadash_panic_exit(void);
+
+/* The panic view without taking over the screen; skipped while one is drawn */
+void vgadash_panic_paint_tail(const char *why);
+
+/* The user took the screen back from an oops paint; the next oops paints again */
+void vgadash_panic_release(void);
+
+#endif
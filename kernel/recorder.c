@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Frame flight recorder.
+ *
+ * Every frame put on screen is appended to a fixed-size byte ring:
+ * a full keyframe every rec_key_every frames, otherwise only the runs of cells
+ * that changed since the previous frame. An unchanged redraw costs just an
+ * entry header. When the ring is full the oldest entries are evicted; the
+ * export starts at the oldest surviving keyframe.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+
+#include "vgadash.h"
+#include "recorder.h"
+
+#define REC_KEY_BYTES (sizeof(struct rec_entry_hdr) + VGA_CELLS * sizeof(u16))
+
+/* A run header costs two cells, so bridging a gap of up to two is never worse */
+#define REC_RUN_GAP 2
+
+static unsigned int rec_kb = 256;
+module_param(rec_kb, uint, 0444);
+MODULE_PARM_DESC(rec_kb, "Frame recorder size in KiB (0 disables)");
+
+static unsigned int rec_key_every = 128;
+module_param(rec_key_every, uint, 0644);
+MODULE_PARM_DESC(rec_key_every, "Frames between recorder keyframes");
+
+struct rec_ring {
+	char *buf;
+	u32 size;
+	u32 head;       /* next write offset */
+	u32 tail;       /* oldest entry */
+	u32 used;
+	u32 count;
+	u32 dropped;
+	u32 seq;
+	u32 since_key;  /* frames since the last keyframe */
+};
+
+static DEFINE_MUTEX(rec_lock);
+static struct rec_ring rec;
+static u16 rec_prev[VGA_CELLS];
+static char *rec_scratch;  /* REC_KEY_BYTES, one encoded entry */
+
+static void ring_put(struct rec_ring *r, u32 off, const void *src, u32 n)
+{
+	u32 first = min(n, r->size - off);
+
+	memcpy(r->buf + off, src, first);
+	memcpy(r->buf, (const char *)src + first, n - first);
+}
+
+static void ring_get(const struct rec_ring *r, u32 off, void *dst, u32 n)
+{
+	u32 first = min(n, r->size - off);
+
+	memcpy(dst, r->buf + off, first);
+	memcpy((char *)dst + first, r->buf, n - first);
+}
+
+static void rec_drop_oldest(struct rec_ring *r)
+{
+	struct rec_entry_hdr h;
+
+	ring_get(r, r->tail, &h, sizeof(h));
+	r->tail = (r->tail + h.len) % r->size;
+	r->used -= h.len;
+	r->count--;
+	r->dropped++;
+}
+
+/* Encode `frame` as runs against rec_prev; returns the entry length, 0 if a keyframe is smaller */
+static u32 rec_encode_delta(const u16 *frame, struct rec_entry_hdr *h)
+{
+	char *p = rec_scratch + sizeof(*h);
+	char *end = rec_scratch + REC_KEY_BYTES;
+	int i = 0;
+
+	h->nruns = 0;
+	while (i < VGA_CELLS) {
+		u16 start, count;
+		int j, last;
+
+		if (frame[i] == rec_prev[i]) {
+			i++;
+			continue;
+		}
+
+		last = i + 1;
+		for (j = i + 1; j < VGA_CELLS && j - last <= REC_RUN_GAP; j++) {
+			if (frame[j] != rec_prev[j])
+				last = j + 1;
+		}
+
+		start = i;
+		count = last - i;
+		if (p + 2 * sizeof(u16) + count * sizeof(u16) >= end)
+			return 0;
+
+		memcpy(p, &start, sizeof(start));
+		memcpy(p + sizeof(u16), &count, sizeof(count));
+		memcpy(p + 2 * sizeof(u16), &frame[i], count * sizeof(u16));
+		p += 2 * sizeof(u16) + count * sizeof(u16);
+		h->nruns++;
+		i = last;
+	}
+
+	return p - rec_scratch;
+}
+
+void vgadash_recorder_add(const u16 *frame, u8 page)
+{
+	struct rec_entry_hdr h;
+	u32 len = 0;
+
+	if (!rec.buf)
+		return;
+
+	memset(&h, 0, sizeof(h));
+	h.ts_ns = ktime_get_ns();
+	h.page = page;
+
+	mutex_lock(&rec_lock);
+
+	if (rec.count && rec.since_key + 1 < max(rec_key_every, 1U)) {
+		h.kind = REC_DELTA;
+		len = rec_encode_delta(frame, &h);
+	}
+	if (!len) {
+		h.kind = REC_KEY;
+		h.nruns = 0;
+		len = REC_KEY_BYTES;
+		memcpy(rec_scratch + sizeof(h), frame, VGA_CELLS * sizeof(u16));
+	}
+
+	h.seq = rec.seq++;
+	h.len = len;
+	memcpy(rec_scratch, &h, sizeof(h));
+
+	while (rec.count && rec.size - rec.used < len)
+		rec_drop_oldest(&rec);
+
+	ring_put(&rec, rec.head, rec_scratch, len);
+	rec.head = (rec.head + len) % rec.size;
+	rec.used += len;
+	rec.count++;
+	rec.since_key = (h.kind == REC_KEY) ? 0 : rec.since_key + 1;
+
+	memcpy(rec_prev, frame, sizeof(rec_prev));
+
+	mutex_unlock(&rec_lock);
+}
+
+void *vgadash_recorder_export(size_t *len)
+{
+	struct rec_file_hdr fh = {
+		.magic = REC_MAGIC,
+		.version = REC_VERSION,
+		.cols = VGA_COLS,
+		.rows = VGA_ROWS,
+	};
+	struct rec_entry_hdr h;
+	char *out;
+	size_t n = sizeof(fh);
+	bool keyed = false;
+	u32 off, i;
+
+	mutex_lock(&rec_lock);
+
+	out = kvmalloc(sizeof(fh) + rec.used, GFP_KERNEL);
+	if (!out) {
+		mutex_unlock(&rec_lock);
+		return NULL;
+	}
+
+	/* Deltas before the oldest surviving keyframe have nothing to apply to */
+	off = rec.tail;
+	for (i = 0; i < rec.count; i++) {
+		ring_get(&rec, off, &h, sizeof(h));
+		if (h.kind == REC_KEY)
+			keyed = true;
+		if (keyed) {
+			ring_get(&rec, off, out + n, h.len);
+			n += h.len;
+			fh.nframes++;
+		}
+		off = (off + h.len) % rec.size;
+	}
+	fh.dropped = rec.dropped;
+
+	mutex_unlock(&rec_lock);
+
+	memcpy(out, &fh, sizeof(fh));
+	*len = n;
+	return out;
+}
+
+int vgadash_recorder_init(void)
+{
+	if (!rec_kb)
+		return 0;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.size = max_t(u32, rec_kb * 1024, 2 * REC_KEY_BYTES);
+	rec.buf = kvmalloc(rec.size, GFP_KERNEL);
+	rec_scratch = kvmalloc(REC_KEY_BYTES, GFP_KERNEL);
+
+	if (!rec.buf || !rec_scratch) {
+		vgadash_recorder_exit();
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+void vgadash_recorder_exit(void)
+{
+	kvfree(rec.buf);
+	kvfree(rec_scratch);
+	rec.buf = NULL;
+	rec_scratch = NULL;
+}
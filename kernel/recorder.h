@@ -0,0 +1,52 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _RECORDER_H_
+#define _RECORDER_H_
+
+#include <linux/types.h>
+
+/*
+ * Recording export format (little endian), as read from debugfs "recording":
+ *
+ *   struct rec_file_hdr, then nframes entries, the first being a keyframe.
+ *   Each entry is a struct rec_entry_hdr followed by its payload:
+ *     REC_KEY:   VGA_CELLS u16 cells
+ *     REC_DELTA: nruns x { u16 start; u16 count; u16 cells[count]; }
+ *                applied to the previous frame
+ */
+#define REC_MAGIC   0x52444756 /* "VGDR" */
+#define REC_VERSION 1
+
+enum rec_kind {
+	REC_KEY   = 1,
+	REC_DELTA = 2,
+};
+
+struct rec_file_hdr {
+	u32 magic;
+	u16 version;
+	u8 cols;
+	u8 rows;
+	u32 nframes;
+	u32 dropped;  /* frames evicted since load */
+} __packed;
+
+struct rec_entry_hdr {
+	u64 ts_ns;    /* ktime_get_ns() at render */
+	u32 seq;      /* frame number since load */
+	u32 len;      /* entry size including this header */
+	u8 kind;
+	u8 page;      /* page that was on screen */
+	u16 nruns;
+	u32 rsvd;
+} __packed;
+
+int  vgadash_recorder_init(void);
+void vgadash_recorder_exit(void);
+
+/* Record one rendered frame; called with the render lock held */
+void vgadash_recorder_add(const u16 *frame, u8 page);
+
+/* Linearised copy of the recording in the export format; kvfree() it */
+void *vgadash_recorder_export(size_t *len);
+
+#endif
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/hash.h>
+#include <linux/list.h>
+
+#include "rowcache.h"
+
+static void rowcache_init(struct rowcache *rc)
+{
+	int i;
+
+	INIT_LIST_HEAD(&rc->lru);
+	for (i = 0; i < ROWCACHE_ROWS; i++) {
+		INIT_HLIST_HEAD(&rc->hash[i]);
+		INIT_HLIST_NODE(&rc->ents[i].node);
+		rc->ents[i].used = false;
+		list_add_tail(&rc->ents[i].lru, &rc->lru);
+	}
+	rc->ready = true;
+}
+
+static struct rowcache_ent *rowcache_find(struct rowcache *rc, u64 key)
+{
+	struct rowcache_ent *e;
+
+	hlist_for_each_entry(e, &rc->hash[hash_64(key, ROWCACHE_BITS)], node) {
+		if (e->key == key)
+			return e;
+	}
+	return NULL;
+}
+
+const u16 *rowcache_get(struct rowcache *rc, u64 key)
+{
+	struct rowcache_ent *e;
+
+	if (unlikely(!rc->ready))
+		rowcache_init(rc);
+
+	e = rowcache_find(rc, key);
+	if (!e)
+		return NULL;
+
+	list_move(&e->lru, &rc->lru);
+	return e->cells;
+}
+
+u16 *rowcache_put(struct rowcache *rc, u64 key)
+{
+	struct rowcache_ent *e;
+
+	if (unlikely(!rc->ready))
+		rowcache_init(rc);
+
+	e = list_last_entry(&rc->lru, struct rowcache_ent, lru);
+	if (e->used)
+		hlist_del(&e->node);
+
+	e->key = key;
+	e->used = true;
+	hlist_add_head(&e->node, &rc->hash[hash_64(key, ROWCACHE_BITS)]);
+	list_move(&e->lru, &rc->lru);
+	return e->cells;
+}
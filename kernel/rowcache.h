@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _VGADASH_ROWCACHE_H_
+#define _VGADASH_ROWCACHE_H_
+
+#include <linux/list.h>
+#include <linux/types.h>
+
+#include "vgadash.h"
+
+#define ROWCACHE_BITS 6
+#define ROWCACHE_ROWS (1 << ROWCACHE_BITS) /* two screens of rows */
+
+/* Rows are keyed by record sequence number and wrapped row within it */
+#define ROWCACHE_MAX_SUB       0xFF
+#define ROWCACHE_KEY(seq, sub) (((u64)(seq) << 8) | (sub))
+
+struct rowcache_ent {
+	u64 key;
+	bool used;
+	struct hlist_node node;
+	struct list_head lru;
+	u16 cells[VGA_COLS];
+};
+
+/*
+ * Fixed-size LRU of fully rendered 80-cell rows. Not locked: the owner
+ * serialises access (the logs page only uses it under the render lock).
+ */
+struct rowcache {
+	bool ready;
+	struct hlist_head hash[ROWCACHE_ROWS];
+	struct list_head lru; /* most recently used first */
+	struct rowcache_ent ents[ROWCACHE_ROWS];
+};
+
+/* Cached cells for `key`, now most recently used; NULL on a miss */
+const u16 *rowcache_get(struct rowcache *rc, u64 key);
+
+/* Slot for `key`, taken from the least recently used row; the caller fills it */
+u16 *rowcache_put(struct rowcache *rc, u64 key);
+
+#endif
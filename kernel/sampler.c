@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Central metrics sampling.
+ *
+ * One delayed work samples the system every SAMPLER_PERIOD_MS, caches the raw
+ * values and appends fixed-point samples to ring series at 1 s resolution.
+ * Every 10 one-second samples are averaged into the 10 s series, and every
+ * 6 of those into the 1 min series. Pages and snapshot readers only copy
+ * the cached data under a seqlock; they never trigger collection.
+ */
+#include <linux/kernel.h>
+#include <linux/cpumask.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/sched/loadavg.h>
+#include <linux/seqlock.h>
+#include <linux/string.h>
+#include <linux/sysinfo.h>
+#include <linux/timekeeping.h>
+#include <linux/workqueue.h>
+
+#include "vgadash.h"
+#include "logtap.h"
+#include "iostats.h"
+#include "cgstats.h"
+#include "alerts.h"
+#include "metrics.h"
+#include "sampler.h"
+
+struct series {
+	u32 v[SERIES_LEN];
+	u32 head;  /* next write */
+	u32 count;
+};
+
+static DEFINE_SEQLOCK(sampler_lock);
+static struct sampler_snap latest;
+static struct series series[SM_NR_METRICS][SR_NR_RES];
+
+/* Samples of resolution r-1 averaged into one sample of resolution r */
+static const u32 sr_factor[SR_NR_RES] = { 1, 10, 6 };
+
+/* Downsampling state; only touched by the sampling work */
+static u64 acc[SM_NR_METRICS][SR_NR_RES];
+static u32 acc_n[SR_NR_RES];
+
+static const char * const metric_names[SM_NR_METRICS] = {
+	[SM_MEM_FREE] = "mem_free_mib",
+	[SM_LOAD1]    = "load1",
+	[SM_LOG_RATE] = "log_rate",
+};
+
+static const char * const res_names[SR_NR_RES] = {
+	[SR_1S]  = "1s",
+	[SR_10S] = "10s",
+	[SR_1M]  = "1m",
+};
+
+static void sampler_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(sampler_work, sampler_work_fn);
+
+static inline void series_push(struct series *s, u32 v)
+{
+	s->v[s->head] = v;
+	s->head = (s->head + 1) % SERIES_LEN;
+	if (s->count < SERIES_LEN)
+		s->count++;
+}
+
+/* Called under the write side of sampler_lock */
+static void series_feed(const u32 *vals)
+{
+	u32 cur[SM_NR_METRICS];
+	int r, m;
+
+	memcpy(cur, vals, sizeof(cur));
+
+	for (r = 0; ; r++) {
+		for (m = 0; m < SM_NR_METRICS; m++)
+			series_push(&series[m][r], cur[m]);
+
+		if (r + 1 == SR_NR_RES)
+			break;
+
+		for (m = 0; m < SM_NR_METRICS; m++)
+			acc[m][r + 1] += cur[m];
+		if (++acc_n[r + 1] < sr_factor[r + 1])
+			break;
+
+		for (m = 0; m < SM_NR_METRICS; m++) {
+			cur[m] = (u32)div_u64(acc[m][r + 1], sr_factor[r + 1]);
+			acc[m][r + 1] = 0;
+		}
+		acc_n[r + 1] = 0;
+	}
+}
+
+static inline u32 to_fixed(u64 v)
+{
+	return (u32)min_t(u64, v << SERIES_FRAC, U32_MAX);
+}
+
+static void sampler_tick(void)
+{
+	struct sampler_snap s;
+	struct sysinfo si;
+	u32 vals[SM_NR_METRICS];
+	int i;
+
+	memset(&s, 0, sizeof(s));
+
+	si_meminfo(&si);
+	s.uptime_s      = ktime_get_boottime_seconds();
+	s.mem_total_mib = (u64)si.totalram * si.mem_unit / (1024ULL * 1024ULL);
+	s.mem_free_mib  = (u64)si.freeram  * si.mem_unit / (1024ULL * 1024ULL);
+	for (i = 0; i < 3; i++)
+		s.load[i] = READ_ONCE(avenrun[i]);
+	s.cpus_online = num_online_cpus();
+
+	vgadash_logtap_counters(&s.log_records, &s.log_bytes);
+	if (latest.seq)
+		s.log_rate = (u32)(s.log_records - latest.log_records);
+
+	vals[SM_MEM_FREE] = to_fixed(s.mem_free_mib);
+	vals[SM_LOAD1]    = (u32)(s.load[0] >> (FSHIFT - SERIES_FRAC));
+	vals[SM_LOG_RATE] = to_fixed(s.log_rate);
+
+	write_seqlock(&sampler_lock);
+	s.seq = latest.seq + 1;
+	latest = s;
+	series_feed(vals);
+	write_sequnlock(&sampler_lock);
+}
+
+static void sampler_work_fn(struct work_struct *work)
+{
+	sampler_tick();
+	vgadash_io_tick();
+	vgadash_cg_tick();
+	vgadash_metrics_rebuild();
+	vgadash_alert_tick();
+
+	schedule_delayed_work(&sampler_work, msecs_to_jiffies(SAMPLER_PERIOD_MS));
+}
+
+void vgadash_sampler_init(void)
+{
+	/* First sample right away so pages have data on the first render */
+	schedule_delayed_work(&sampler_work, 0);
+}
+
+void vgadash_sampler_exit(void)
+{
+	cancel_delayed_work_sync(&sampler_work);
+}
+
+void vgadash_sampler_latest(struct sampler_snap *out)
+{
+	unsigned int seq;
+
+	do {
+		seq = read_seqbegin(&sampler_lock);
+		*out = latest;
+	} while (read_seqretry(&sampler_lock, seq));
+}
+
+int vgadash_sampler_series(enum sampler_metric m, enum sampler_res r, u32 *out, int max)
+{
+	const struct series *s = &series[m][r];
+	unsigned int seq;
+	int n, i, start;
+
+	do {
+		seq = read_seqbegin(&sampler_lock);
+		n = min_t(int, s->count, max);
+		start = (s->head + SERIES_LEN - n) % SERIES_LEN;
+		for (i = 0; i < n; i++)
+			out[i] = s->v[(start + i) % SERIES_LEN];
+	} while (read_seqretry(&sampler_lock, seq));
+
+	return n;
+}
+
+void vgadash_sampler_sparkline(enum sampler_metric m, enum sampler_res r,
+			       char *out, int width)
+{
+	static const char ramp[] = "_.,:-=+*#";
+	const int levels = sizeof(ramp) - 1;
+	u32 v[SERIES_LEN];
+	u32 lo = U32_MAX, hi = 0;
+	int n, i, pad;
+
+	width = min(width, SERIES_LEN);
+	n = vgadash_sampler_series(m, r, v, width);
+
+	for (i = 0; i < n; i++) {
+		lo = min(lo, v[i]);
+		hi = max(hi, v[i]);
+	}
+
+	/* Right-align so the newest sample always sits in the last column */
+	pad = width - n;
+	memset(out, ' ', pad);
+	for (i = 0; i < n; i++) {
+		int lvl = (hi > lo) ? (int)((u64)(v[i] - lo) * (levels - 1) / (hi - lo)) : 0;
+
+		out[pad + i] = ramp[lvl];
+	}
+	out[width] = '\0';
+}
+
+const char *vgadash_sampler_metric_name(enum sampler_metric m)
+{
+	return metric_names[m];
+}
+
+const char *vgadash_sampler_res_name(enum sampler_res r)
+{
+	return res_names[r];
+}
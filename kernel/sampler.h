@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _SAMPLER_H_
+#define _SAMPLER_H_
+
+#include <linux/types.h>
+
+#define SAMPLER_PERIOD_MS 1000
+#define SERIES_LEN        64
+
+/* Series values are unsigned fixed point with SERIES_FRAC fractional bits */
+#define SERIES_FRAC 8
+#define SERIES_ONE  (1U << SERIES_FRAC)
+
+enum sampler_metric {
+	SM_MEM_FREE,   /* MiB */
+	SM_LOAD1,      /* 1-minute load average */
+	SM_LOG_RATE,   /* captured console records per second */
+	SM_NR_METRICS,
+};
+
+enum sampler_res {
+	SR_1S,
+	SR_10S,
+	SR_1M,
+	SR_NR_RES,
+};
+
+/* Latest raw values; refreshed only by the sampling tick */
+struct sampler_snap {
+	u64 seq;             /* tick counter, 0 until the first sample */
+	u64 uptime_s;
+	u64 mem_total_mib;
+	u64 mem_free_mib;
+	unsigned long load[3]; /* avenrun fixed point (FSHIFT) */
+	u32 cpus_online;
+	u64 log_records;     /* totals since load */
+	u64 log_bytes;
+	u32 log_rate;        /* records/s over the last tick */
+};
+
+void vgadash_sampler_init(void);
+void vgadash_sampler_exit(void);
+
+void vgadash_sampler_latest(struct sampler_snap *out);
+
+/* Oldest-first copy of up to `max` samples; returns count copied */
+int vgadash_sampler_series(enum sampler_metric m, enum sampler_res r, u32 *out, int max);
+
+/* Text sparkline of the newest `width` samples, NUL-terminated */
+void vgadash_sampler_sparkline(enum sampler_metric m, enum sampler_res r,
+			       char *out, int width);
+
+const char *vgadash_sampler_metric_name(enum sampler_metric m);
+const char *vgadash_sampler_res_name(enum sampler_res r);
+
+#endif
@@ -0,0 +1,369 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Serial/ANSI mirror backend.
+ *
+ * Sends each frame to a tty (serial_mirror=/dev/ttyS1, a BMC SOL port, ...)
+ * as ANSI escape sequences. Only cells that differ from what the terminal
+ * already shows are sent: short gaps between changed cells are bridged,
+ * the cursor is moved with the shortest of CR/CRLF/CUP, SGR only carries
+ * the attribute parts that changed, runs of one cell use REP, and blank row
+ * tails use EL. An idle redraw is a handful of bytes, which keeps a live
+ * dashboard usable at 115200 baud.
+ *
+ * The frame is encoded under the render lock but written to the tty from a
+ * work item, so a slow port never holds up rendering. While a write is still
+ * in flight the next frames are dropped and counted; the terminal state only
+ * advances with frames that were sent, so the next one catches up.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+#include <linux/workqueue.h>
+
+#include "vgadash.h"
+#include "backend.h"
+
+#define SER_RESERVE  32  /* worst case for one cell: CUP + SGR + char */
+/* A whole frame, each cell at its worst, plus a CUP and EL per row */
+#define SER_BUF_SIZE ((VGA_CELLS + VGA_ROWS) * SER_RESERVE)
+#define SER_GAP      3   /* rewriting this many unchanged cells beats a CUP */
+#define SER_REP_MIN  6   /* shorter runs are cheaper spelled out */
+#define SER_EL_MIN   4
+
+static char *serial_mirror;
+module_param(serial_mirror, charp, 0444);
+MODULE_PARM_DESC(serial_mirror, "tty to mirror the dashboard to as ANSI, e.g. /dev/ttyS1");
+
+static bool serial_rep = true;
+module_param(serial_rep, bool, 0644);
+MODULE_PARM_DESC(serial_rep, "Use the REP escape for runs (disable for dumb terminals)");
+
+struct ser_state {
+	struct file *filp;
+	char *buf;             /* frame being encoded */
+	size_t len;
+	char *out;             /* frame being written by ser_work */
+	size_t out_len;
+	bool writing;          /* ser_work owns out */
+	bool lost;             /* the last write came up short */
+	u16 shown[VGA_CELLS];  /* what the terminal displays */
+	bool valid;            /* false: terminal content unknown, redraw all */
+	int cx, cy;            /* cursor, -1 when unknown */
+	int attr;              /* current attribute, -1 when unknown */
+
+	/* Stats, read locklessly by metrics */
+	u64 frames;
+	u64 bytes;
+	u64 dropped;           /* frames skipped while the port was backed up */
+	u32 last_bytes;
+	u32 max_bytes;
+};
+
+static struct ser_state ser;
+
+/* VGA colour index (BGR) -> ANSI colour index (RGB) */
+static const u8 vga_to_ansi[8] = { 0, 4, 2, 6, 1, 5, 3, 7 };
+
+/* Outside the render lock; a backed-up port only blocks this work */
+static void ser_work_fn(struct work_struct *work)
+{
+	loff_t pos = 0;
+	ssize_t n;
+
+	n = kernel_write(ser.filp, ser.out, ser.out_len, &pos);
+	if (n != ser.out_len)
+		WRITE_ONCE(ser.lost, true);
+
+	WRITE_ONCE(ser.frames, ser.frames + 1);
+	WRITE_ONCE(ser.bytes, ser.bytes + ser.out_len);
+	WRITE_ONCE(ser.last_bytes, ser.out_len);
+	WRITE_ONCE(ser.max_bytes, max_t(u32, ser.max_bytes, ser.out_len));
+
+	/* Hands out back to serial_flush() */
+	smp_store_release(&ser.writing, false);
+}
+
+static DECLARE_WORK(ser_work, ser_work_fn);
+
+/* Write what is encoded from the caller, blocking; detach only */
+static void ser_write_now(void)
+{
+	loff_t pos = 0;
+
+	if (ser.len)
+		kernel_write(ser.filp, ser.buf, ser.len, &pos);
+	ser.len = 0;
+}
+
+static __printf(1, 2) void ser_printf(const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	ser.len += vscnprintf(ser.buf + ser.len, SER_BUF_SIZE - ser.len, fmt, args);
+	va_end(args);
+}
+
+static inline void ser_putc(char c)
+{
+	ser.buf[ser.len++] = c;
+}
+
+static void ser_move(int x, int y)
+{
+	if (ser.cx == x && ser.cy == y)
+		return;
+
+	if (x == 0 && ser.cy == y)
+		ser_putc('\r');
+	else if (x == 0 && ser.cy >= 0 && y == ser.cy + 1)
+		ser_printf("\r\n");
+	else if (x == 0)
+		ser_printf("\x1b[%dH", y + 1);
+	else
+		ser_printf("\x1b[%d;%dH", y + 1, x + 1);
+
+	ser.cx = x;
+	ser.cy = y;
+}
+
+static void ser_attr(u8 a)
+{
+	u8 fg = a & 0x0F, bg = (a >> 4) & 0x07;
+	u8 ofg = ser.attr & 0x0F, obg = (ser.attr >> 4) & 0x07;
+	bool sep = false;
+
+	if (ser.attr == a)
+		return;
+
+	ser_printf("\x1b[");
+	if (ser.attr < 0 || (fg & 8) != (ofg & 8)) {
+		ser_printf("%s", (fg & 8) ? "1" : "22");
+		sep = true;
+	}
+	if (ser.attr < 0 || (fg & 7) != (ofg & 7)) {
+		ser_printf("%s%d", sep ? ";" : "", 30 + vga_to_ansi[fg & 7]);
+		sep = true;
+	}
+	if (ser.attr < 0 || bg != obg)
+		ser_printf("%s%d", sep ? ";" : "", 40 + vga_to_ansi[bg]);
+	ser_putc('m');
+
+	ser.attr = a;
+}
+
+static inline char cell_char(u16 c)
+{
+	u8 ch = c & 0xFF;
+
+	return (ch >= 0x20 && ch < 0x7F) ? ch : ' ';
+}
+
+static inline bool cell_dirty(const u16 *frame, int i)
+{
+	return !ser.valid || frame[i] != ser.shown[i];
+}
+
+/* First column from which the row is one blank cell repeated to the end */
+static int blank_tail(const u16 *row)
+{
+	int x = VGA_COLS;
+
+	if (cell_char(row[VGA_COLS - 1]) != ' ')
+		return VGA_COLS;
+	while (x > 0 && row[x - 1] == row[VGA_COLS - 1])
+		x--;
+	return x;
+}
+
+/* Emit cells [x, end) of row y */
+static void ser_cells(const u16 *frame, int y, int x, int end)
+{
+	const u16 *row = frame + y * VGA_COLS;
+
+	ser_move(x, y);
+	while (x < end) {
+		int n = 1;
+
+		ser_attr(row[x] >> 8);
+		ser_putc(cell_char(row[x]));
+
+		if (serial_rep) {
+			while (x + n < end && row[x + n] == row[x])
+				n++;
+			if (n >= SER_REP_MIN)
+				ser_printf("\x1b[%db", n - 1);
+			else
+				n = 1;
+		}
+		x += n;
+	}
+
+	/* The last column leaves the cursor in the terminal's pending-wrap state */
+	ser.cx = (x < VGA_COLS) ? x : -1;
+}
+
+static void ser_row(const u16 *frame, int y)
+{
+	const u16 *row = frame + y * VGA_COLS;
+	int tail = blank_tail(row);
+	int x = 0;
+
+	while (x < VGA_COLS) {
+		int j, last;
+
+		if (!cell_dirty(frame, y * VGA_COLS + x)) {
+			x++;
+			continue;
+		}
+
+		/* Dirty blank tail: clear to end of line in the tail's attribute */
+		if (x >= tail && VGA_COLS - tail >= SER_EL_MIN) {
+			ser_move(x, y);
+			ser_attr(row[x] >> 8);
+			ser_printf("\x1b[K");
+			break;
+		}
+
+		last = x + 1;
+		for (j = x + 1; j < VGA_COLS && j - last <= SER_GAP; j++) {
+			if (cell_dirty(frame, y * VGA_COLS + j))
+				last = j + 1;
+		}
+		if (last > tail && VGA_COLS - tail >= SER_EL_MIN)
+			last = max(tail, x + 1);
+
+		ser_cells(frame, y, x, last);
+		x = last;
+	}
+}
+
+static void serial_flush(const u16 *frame)
+{
+	int y;
+
+	if (!ser.filp)
+		return;
+
+	/* Port still busy with an earlier frame: skip this one */
+	if (smp_load_acquire(&ser.writing)) {
+		WRITE_ONCE(ser.dropped, ser.dropped + 1);
+		return;
+	}
+
+	/* Lost output leaves the terminal unknown; repaint everything */
+	if (ser.lost) {
+		ser.lost = false;
+		ser.valid = false;
+	}
+
+	if (!ser.valid) {
+		ser_printf("\x1b[0m\x1b[H\x1b[2J");
+		ser.cx = 0;
+		ser.cy = 0;
+		ser.attr = -1;
+	}
+
+	for (y = 0; y < VGA_ROWS; y++)
+		ser_row(frame, y);
+
+	memcpy(ser.shown, frame, sizeof(ser.shown));
+	ser.valid = true;
+
+	/* Nothing changed: no write, but still a frame */
+	if (!ser.len) {
+		WRITE_ONCE(ser.frames, ser.frames + 1);
+		WRITE_ONCE(ser.last_bytes, 0);
+		return;
+	}
+
+	swap(ser.buf, ser.out);
+	ser.out_len = ser.len;
+	ser.len = 0;
+	ser.writing = true;
+	schedule_work(&ser_work);
+}
+
+static int serial_attach(void)
+{
+	struct file *f;
+
+	if (!serial_mirror || !*serial_mirror)
+		return -ENODEV;
+
+	f = filp_open(serial_mirror, O_WRONLY | O_NOCTTY, 0);
+	if (IS_ERR(f)) {
+		pr_warn(VGADASH_NAME ": cannot open %s: %ld\n", serial_mirror, PTR_ERR(f));
+		return PTR_ERR(f);
+	}
+
+	ser.buf = kvmalloc(SER_BUF_SIZE, GFP_KERNEL);
+	ser.out = kvmalloc(SER_BUF_SIZE, GFP_KERNEL);
+	if (!ser.buf || !ser.out) {
+		kvfree(ser.buf);
+		kvfree(ser.out);
+		ser.buf = NULL;
+		ser.out = NULL;
+		filp_close(f, NULL);
+		return -ENOMEM;
+	}
+
+	ser.filp = f;
+	ser.len = 0;
+	ser.writing = false;
+	ser.lost = false;
+	ser.valid = false;
+
+	ser_printf("\x1b[?25l"); /* hide the cursor */
+	return 0;
+}
+
+static void serial_detach(void)
+{
+	if (!ser.filp)
+		return;
+
+	/* The restore sequence goes out after the last frame */
+	flush_work(&ser_work);
+
+	ser.len = 0;
+	ser_printf("\x1b[0m\x1b[H\x1b[2J\x1b[?25h");
+	ser_write_now();
+
+	filp_close(ser.filp, NULL);
+	kvfree(ser.buf);
+	kvfree(ser.out);
+	ser.filp = NULL;
+	ser.buf = NULL;
+	ser.out = NULL;
+}
+
+static void serial_show(struct seq_file *m)
+{
+	u64 frames = READ_ONCE(ser.frames);
+
+	seq_printf(m, "%s frames=%llu bytes=%llu last=%u max=%u avg=%llu dropped=%llu\n",
+		   serial_mirror ? serial_mirror : "(unset)", frames,
+		   READ_ONCE(ser.bytes), READ_ONCE(ser.last_bytes), READ_ONCE(ser.max_bytes),
+		   frames ? div64_u64(READ_ONCE(ser.bytes), frames) : 0,
+		   READ_ONCE(ser.dropped));
+}
+
+void vgadash_serial_stats(u64 *frames, u64 *bytes, u32 *last_bytes)
+{
+	*frames = READ_ONCE(ser.frames);
+	*bytes = READ_ONCE(ser.bytes);
+	*last_bytes = READ_ONCE(ser.last_bytes);
+}
+
+const struct vgadash_backend vgadash_serial_backend = {
+	.name   = "serial",
+	.attach = serial_attach,
+	.detach = serial_detach,
+	.flush  = serial_flush,
+	.show   = serial_show,
+};
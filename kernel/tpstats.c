@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Scheduler / IRQ / syscall rates from tracepoint probes.
+ *
+ * Probes only bump per-CPU counters; nothing is recorded per event. The
+ * render path folds the CPUs together and turns the deltas into rates.
+ * Probes are attached only while the sched page is on screen.
+ *
+ * Probe prototypes follow the 5.15 tracepoint definitions.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+#include <linux/tracepoint.h>
+
+#include "vgadash.h"
+#include "tpstats.h"
+
+#define TP_NR_SYSCALLS     512
+#define TP_MIN_INTERVAL_MS 200
+
+static bool tracepoints = true;
+module_param(tracepoints, bool, 0644);
+MODULE_PARM_DESC(tracepoints, "Attach sched/irq/syscall tracepoint probes for the sched page");
+
+struct tp_pcpu {
+	u64 ctxsw;
+	u64 wakeups;
+	u64 irqs;
+	u64 syscalls;
+	u32 sys_nr[TP_NR_SYSCALLS];
+};
+
+static DEFINE_PER_CPU(struct tp_pcpu, tp_pcpu);
+
+static void probe_sched_switch(void *data, bool preempt,
+			       struct task_struct *prev, struct task_struct *next)
+{
+	this_cpu_inc(tp_pcpu.ctxsw);
+}
+
+static void probe_sched_wakeup(void *data, struct task_struct *p)
+{
+	this_cpu_inc(tp_pcpu.wakeups);
+}
+
+static void probe_irq_handler_entry(void *data, int irq, struct irqaction *action)
+{
+	this_cpu_inc(tp_pcpu.irqs);
+}
+
+static void probe_sys_enter(void *data, struct pt_regs *regs, long id)
+{
+	this_cpu_inc(tp_pcpu.syscalls);
+	if ((unsigned long)id < TP_NR_SYSCALLS)
+		this_cpu_inc(tp_pcpu.sys_nr[id]);
+}
+
+struct tp_probe {
+	const char *name;
+	void *probe;
+	struct tracepoint *tp;
+	bool registered;
+};
+
+static struct tp_probe tp_probes[] = {
+	{ .name = "sched_switch",      .probe = probe_sched_switch },
+	{ .name = "sched_wakeup",      .probe = probe_sched_wakeup },
+	{ .name = "irq_handler_entry", .probe = probe_irq_handler_entry },
+	{ .name = "sys_enter",         .probe = probe_sys_enter },
+	{ }
+};
+
+/* Fold state, protected by tp_mutex */
+static DEFINE_MUTEX(tp_mutex);
+static bool tp_running;
+static bool tp_looked_up;
+static u64 last_ns;
+static u64 prev_ctxsw, prev_wakeups, prev_irqs, prev_syscalls;
+static u32 prev_sys[TP_NR_SYSCALLS];
+static u64 *prev_cpu_ctxsw;
+static u32 *cpu_ctxsw_rate;
+static struct tp_rates cur;
+
+/* Tracepoint structs are not exported; find them by name */
+static void tp_lookup(struct tracepoint *tp, void *priv)
+{
+	struct tp_probe *p;
+
+	for (p = tp_probes; p->name; p++) {
+		if (!strcmp(tp->name, p->name))
+			p->tp = tp;
+	}
+}
+
+void vgadash_tp_start(void)
+{
+	struct tp_probe *p;
+
+	if (!tracepoints)
+		return;
+
+	mutex_lock(&tp_mutex);
+	if (tp_running)
+		goto out;
+
+	if (!tp_looked_up) {
+		for_each_kernel_tracepoint(tp_lookup, NULL);
+		tp_looked_up = true;
+	}
+
+	/* Both or neither: the fold and the reader only test one of them */
+	prev_cpu_ctxsw = kcalloc(nr_cpu_ids, sizeof(*prev_cpu_ctxsw), GFP_KERNEL);
+	cpu_ctxsw_rate = kcalloc(nr_cpu_ids, sizeof(*cpu_ctxsw_rate), GFP_KERNEL);
+	if (!prev_cpu_ctxsw || !cpu_ctxsw_rate) {
+		pr_warn(VGADASH_NAME ": no memory for per-CPU context switch rates\n");
+		kfree(prev_cpu_ctxsw);
+		kfree(cpu_ctxsw_rate);
+		prev_cpu_ctxsw = NULL;
+		cpu_ctxsw_rate = NULL;
+	}
+
+	for (p = tp_probes; p->name; p++) {
+		int ret;
+
+		if (!p->tp) {
+			pr_warn(VGADASH_NAME ": tracepoint %s not found\n", p->name);
+			continue;
+		}
+		ret = tracepoint_probe_register(p->tp, p->probe, NULL);
+		if (ret)
+			pr_warn(VGADASH_NAME ": %s probe failed: %d\n", p->name, ret);
+		else
+			p->registered = true;
+	}
+
+	memset(&cur, 0, sizeof(cur));
+	cur.running = true;
+	last_ns = 0;
+	tp_running = true;
+out:
+	mutex_unlock(&tp_mutex);
+}
+
+void vgadash_tp_stop(void)
+{
+	struct tp_probe *p;
+
+	mutex_lock(&tp_mutex);
+	if (!tp_running)
+		goto out;
+
+	for (p = tp_probes; p->name; p++) {
+		if (p->registered) {
+			tracepoint_probe_unregister(p->tp, p->probe, NULL);
+			p->registered = false;
+		}
+	}
+
+	kfree(prev_cpu_ctxsw);
+	kfree(cpu_ctxsw_rate);
+	prev_cpu_ctxsw = NULL;
+	cpu_ctxsw_rate = NULL;
+
+	cur.running = false;
+	tp_running = false;
+out:
+	mutex_unlock(&tp_mutex);
+}
+
+void vgadash_tp_exit(void)
+{
+	vgadash_tp_stop();
+	tracepoint_synchronize_unregister();
+}
+
+static inline u64 tp_rate(u64 delta, u64 dt_ns)
+{
+	return div64_u64(delta * NSEC_PER_SEC, dt_ns);
+}
+
+static void tp_top_insert(struct tp_rates *r, int nr, u32 rate)
+{
+	int i;
+
+	if (!rate)
+		return;
+	if (r->nr_top == TP_TOP_SYSCALLS && r->top[r->nr_top - 1].rate >= rate)
+		return;
+
+	i = (r->nr_top < TP_TOP_SYSCALLS) ? r->nr_top++ : TP_TOP_SYSCALLS - 1;
+	for (; i > 0 && r->top[i - 1].rate < rate; i--)
+		r->top[i] = r->top[i - 1];
+	r->top[i].nr = nr;
+	r->top[i].rate = rate;
+}
+
+/* Called with tp_mutex held */
+static void tp_fold(void)
+{
+	u64 now = ktime_get_ns();
+	u64 ctxsw = 0, wakeups = 0, irqs = 0, syscalls = 0, dt;
+	bool first = (last_ns == 0);
+	int cpu, nr;
+
+	dt = now - last_ns;
+	if (!first && dt < TP_MIN_INTERVAL_MS * NSEC_PER_MSEC)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		const struct tp_pcpu *pc = per_cpu_ptr(&tp_pcpu, cpu);
+		u64 c = READ_ONCE(pc->ctxsw);
+
+		ctxsw    += c;
+		wakeups  += READ_ONCE(pc->wakeups);
+		irqs     += READ_ONCE(pc->irqs);
+		syscalls += READ_ONCE(pc->syscalls);
+
+		if (prev_cpu_ctxsw && cpu_ctxsw_rate) {
+			if (!first)
+				cpu_ctxsw_rate[cpu] = (u32)tp_rate(c - prev_cpu_ctxsw[cpu], dt);
+			prev_cpu_ctxsw[cpu] = c;
+		}
+	}
+
+	if (!first) {
+		cur.ctxsw    = tp_rate(ctxsw - prev_ctxsw, dt);
+		cur.wakeups  = tp_rate(wakeups - prev_wakeups, dt);
+		cur.irqs     = tp_rate(irqs - prev_irqs, dt);
+		cur.syscalls = tp_rate(syscalls - prev_syscalls, dt);
+		cur.nr_top   = 0;
+		cur.valid    = true;
+	}
+	prev_ctxsw = ctxsw;
+	prev_wakeups = wakeups;
+	prev_irqs = irqs;
+	prev_syscalls = syscalls;
+
+	/* u32 per-syscall sums wrap consistently, so deltas stay correct */
+	for (nr = 0; nr < TP_NR_SYSCALLS; nr++) {
+		u32 sum = 0;
+
+		for_each_possible_cpu(cpu)
+			sum += READ_ONCE(per_cpu_ptr(&tp_pcpu, cpu)->sys_nr[nr]);
+
+		if (!first)
+			tp_top_insert(&cur, nr, (u32)tp_rate(sum - prev_sys[nr], dt));
+		prev_sys[nr] = sum;
+	}
+
+	last_ns = now;
+}
+
+void vgadash_tp_rates(struct tp_rates *out)
+{
+	mutex_lock(&tp_mutex);
+	if (tp_running)
+		tp_fold();
+	*out = cur;
+	mutex_unlock(&tp_mutex);
+}
+
+int vgadash_tp_cpu_ctxsw(u32 *out, int max)
+{
+	int n = 0;
+
+	mutex_lock(&tp_mutex);
+	if (cpu_ctxsw_rate) {
+		n = min_t(int, max, nr_cpu_ids);
+		memcpy(out, cpu_ctxsw_rate, n * sizeof(*out));
+	}
+	mutex_unlock(&tp_mutex);
+
+	return n;
+}
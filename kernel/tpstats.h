@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _TPSTATS_H_
+#define _TPSTATS_H_
+
+#include <linux/types.h>
+
+#define TP_TOP_SYSCALLS 8
+
+struct tp_syscall_rate {
+	int nr;
+	u32 rate;
+};
+
+struct tp_rates {
+	bool running;   /* probes registered */
+	bool valid;     /* at least one interval has been folded */
+	u64 ctxsw;      /* all rates are per second */
+	u64 wakeups;
+	u64 irqs;
+	u64 syscalls;
+	int nr_top;
+	struct tp_syscall_rate top[TP_TOP_SYSCALLS];
+};
+
+/* Register / unregister the probes; used as the sched page enter/leave hooks */
+void vgadash_tp_start(void);
+void vgadash_tp_stop(void);
+void vgadash_tp_exit(void);
+
+/* Fold the per-CPU counters into rates (at most every TP_MIN_INTERVAL_MS) */
+void vgadash_tp_rates(struct tp_rates *out);
+
+/* Per-CPU context switches/s from the last fold; returns CPUs filled */
+int vgadash_tp_cpu_ctxsw(u32 *out, int max);
+
+#endif
@@ -2,10 +2,12 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/io.h>
+#include <linux/seq_file.h>
 #include <asm/io.h>
 
 #include "vga_text.h"
 #include "vgadash.h"
+#include "backend.h"
 
 #define VGA_PHYS  0xB8000
 #define VGA_BYTES (VGA_CELLS * 2)
@@ -63,12 +65,37 @@ void vga_text_save(void __iomem *vga_mem, u16 *out_saved, int cells)
 }
 
 void vga_text_restore(void __iomem *vga_mem, const u16 *saved, int cells)
+{
+	vga_text_blit(vga_mem, saved, cells);
+}
+
+void vga_text_blit(void __iomem *vga_mem, const u16 *frame, int cells)
 {
 	u16 __iomem *vga = (u16 __iomem *)vga_mem;
 	int i;
 
 	for (i = 0; i < cells; i++)
-		writew(saved[i], &vga[i]);
+		writew(frame[i], &vga[i]);
+}
+
+void vga_frame_clear(u16 *frame, u8 attr, int cells)
+{
+	u16 val = ((u16)attr << 8) | (u8)' ';
+	int i;
+
+	for (i = 0; i < cells; i++)
+		frame[i] = val;
+}
+
+void vga_frame_puts_at(u16 *frame, int x, int y, const char *s, u8 attr)
+{
+	int i = 0;
+	int idx = y * VGA_COLS + x;
+
+	while (s[i] && (x + i) < VGA_COLS) {
+		frame[idx + i] = ((u16)attr << 8) | (u8)s[i];
+		i++;
+	}
 }
 
 /* VGA cursor via CRTC ports */
@@ -99,3 +126,48 @@ void vga_cursor_restore(u8 start_saved, u8 end_saved, bool saved_flag)
 	outb(0x0B, 0x3D4);
 	outb(end_saved, 0x3D5);
 }
+
+/* VGA text mode backend: owns the screen at 0xB8000 while attached */
+static int vga_backend_attach(void)
+{
+	int ret;
+
+	ret = vga_text_ensure_mapped(&g_vgadash.vga_mem);
+	if (ret) {
+		pr_err(VGADASH_NAME ": ioremap VGA failed: %d\n", ret);
+		return ret;
+	}
+
+	vga_text_save(g_vgadash.vga_mem, g_vgadash.saved, VGA_CELLS);
+	vga_cursor_save_and_disable(&g_vgadash.cursor_start_saved,
+				    &g_vgadash.cursor_end_saved,
+				    &g_vgadash.cursor_saved);
+	return 0;
+}
+
+static void vga_backend_detach(void)
+{
+	vga_text_restore(g_vgadash.vga_mem, g_vgadash.saved, VGA_CELLS);
+	vga_cursor_restore(g_vgadash.cursor_start_saved,
+			   g_vgadash.cursor_end_saved,
+			   g_vgadash.cursor_saved);
+}
+
+static void vga_backend_flush(const u16 *frame)
+{
+	vga_text_blit(g_vgadash.vga_mem, frame, VGA_CELLS);
+}
+
+static void vga_backend_show(struct seq_file *m)
+{
+	seq_printf(m, "text 0xb8000 %dx%d\n", VGA_COLS, VGA_ROWS);
+}
+
+const struct vgadash_backend vgadash_vga_backend = {
+	.name   = "vga",
+	.screen = true,
+	.attach = vga_backend_attach,
+	.detach = vga_backend_detach,
+	.flush  = vga_backend_flush,
+	.show   = vga_backend_show,
+};
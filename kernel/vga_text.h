@@ -8,10 +8,15 @@
 int  vga_text_ensure_mapped(void __iomem **out);
 void vga_text_save(void __iomem *vga_mem, u16 *out_saved, int cells);
 void vga_text_restore(void __iomem *vga_mem, const u16 *saved, int cells);
+void vga_text_blit(void __iomem *vga_mem, const u16 *frame, int cells);
 
 void vga_text_clear(void __iomem *vga_mem, u8 attr, int cells);
 void vga_text_puts_at(void __iomem *vga_mem, int x, int y, const char *s, u8 attr);
 
+/* Same drawing ops on an in-memory frame (attr << 8 | ch cells) */
+void vga_frame_clear(u16 *frame, u8 attr, int cells);
+void vga_frame_puts_at(u16 *frame, int x, int y, const char *s, u8 attr);
+
 void vga_cursor_save_and_disable(u8 *start_saved, u8 *end_saved, bool *saved_flag);
 void vga_cursor_restore(u8 start_saved, u8 end_saved, bool saved_flag);
 
@@ -7,6 +7,8 @@
 
 #define VGADASH_NAME "vgadash"
 
+struct seq_file;
+
 #define VGA_COLS 80
 #define VGA_ROWS 25
 #define VGA_CELLS (VGA_COLS * VGA_ROWS)
@@ -14,15 +16,33 @@
 enum vgadash_page {
 	VGADASH_PAGE_STATE = 0,
 	VGADASH_PAGE_LOGS  = 1,
+	VGADASH_PAGE_HEAT  = 2,
+	VGADASH_PAGE_SCHED = 3,
+	VGADASH_PAGE_IO    = 4,
+	VGADASH_PAGE_LAT   = 5,
+	VGADASH_PAGE_PREV  = 6,
+	VGADASH_PAGE_CGROUP = 7,
+	VGADASH_PAGE_ONCPU = 8,
+	VGADASH_PAGE_STALL = 9,
+	VGADASH_NR_PAGES,
 };
 
+/* Frame page id while a tiled layout is on screen */
+#define VGADASH_PAGE_TILES 0xFF
+
 struct vgadash_ctx {
 	bool active;
+	bool emergency; /* panic/oops paint on screen; nothing renders over it */
 	enum vgadash_page page;
+	unsigned long entered; /* pages whose enter hook ran */
+	u32 log_view; /* logtap class mask shown on the logs page */
 
 	/* VGA overlay */
 	void __iomem *vga_mem;
 	u16 saved[VGA_CELLS];
+	u16 frame[VGA_CELLS]; /* pages draw here; blitted to vga_mem after render */
+	u16 *canvas;
+	int rows; /* canvas rows a page may fill; fewer inside a tile */
 	bool cursor_saved;
 	u8 cursor_start_saved;
 	u8 cursor_end_saved;
@@ -33,9 +53,44 @@ struct vgadash_ctx {
 
 extern struct vgadash_ctx g_vgadash;
 
-void vgadash_render(void);
+/* Render a frame now, even while the dashboard is off, and wait for it */
+void vgadash_request_frame(void);
 void vgadash_toggle(void);
+int  vgadash_activate(void);
 int  vgadash_set_page(enum vgadash_page p);
+const char *vgadash_page_name(enum vgadash_page p);
+int  vgadash_page_by_name(const char *name);
+int  vgadash_set_log_view(u32 mask);
+
+/* Anchor the logs page at record `seq`, highlighted, until scrolled to the bottom */
+void vgadash_pin_log(u64 seq);
+
+/* Tiled layout, e.g. "state:6@1000 logs@250"; "" or "none" for one page */
+int  vgadash_set_layout(char *spec);
+void vgadash_layout_show(struct seq_file *m);
+
+/* Navigation keys from SysRq / keyboard hotkeys */
+enum vgadash_key {
+	VGADASH_KEY_TOGGLE,
+	VGADASH_KEY_OFF,
+	VGADASH_KEY_NEXT_PAGE,
+	VGADASH_KEY_PREV_PAGE,
+	VGADASH_KEY_LINE_UP,
+	VGADASH_KEY_LINE_DOWN,
+	VGADASH_KEY_PAGE_UP,
+	VGADASH_KEY_PAGE_DOWN,
+	VGADASH_KEY_TOP,
+	VGADASH_KEY_BOTTOM,
+};
+
+/* Queue a key from any context but NMI; the render owner applies it */
+void vgadash_input(enum vgadash_key key);
+
+/* Batched commands for the debugfs ctl file; modifies `batch` */
+#define VGADASH_CTL_MAX_CMDS 16
+int  vgadash_ctl(char *batch);
+
+void vgadash_backends_show(struct seq_file *m);
 
 /* Debugfs */
 int  vgadash_debugfs_init(void);
@@ -136,18 +136,14 @@ insmod /vgadash.ko || {{
 echo "[init] mount debugfs + toggle dashboard..."
 mount -t debugfs none /sys/kernel/debug 2>/dev/null || true
 
-# Make sure dashboard is on and on logs page
-echo logs > /sys/kernel/debug/vgadash/page || true
-echo 1 > /sys/kernel/debug/vgadash/toggle || true
+# Make sure dashboard is on and on logs page (one batch, one render)
+echo "page logs; on" > /sys/kernel/debug/vgadash/ctl || true
 
 # Inject a known kernel log line (does not depend on journald)
 echo "{marker}" > /dev/kmsg || true
 
 # Re-render logs page so the marker shows up
-echo logs > /sys/kernel/debug/vgadash/page || true
-echo 1 > /sys/kernel/debug/vgadash/toggle || true
-echo 1 > /sys/kernel/debug/vgadash/toggle || true
-echo 1 > /sys/kernel/debug/vgadash/toggle || true
+echo "page logs; on; refresh" > /sys/kernel/debug/vgadash/ctl || true
 
 echo "===== VGADASH SNAPSHOT BEGIN =====" > /dev/ttyS0
 cat /sys/kernel/debug/vgadash/snapshot > /dev/ttyS0 || true
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""Replay a vgadash frame recording in a terminal.
+
+The recording comes from /sys/kernel/debug/vgadash/recording (copy it off the
+machine first if you like). The format is described in kernel/recorder.h.
+"""
+import argparse
+import struct
+import sys
+import time
+from pathlib import Path
+from typing import Iterator, List, Tuple
+
+DEFAULT_PATH = Path("/sys/kernel/debug/vgadash/recording")
+
+REC_MAGIC = 0x52444756
+REC_VERSION = 1
+REC_KEY = 1
+REC_DELTA = 2
+
+FILE_HDR = struct.Struct("<IHBBII")        # magic version cols rows nframes dropped
+ENTRY_HDR = struct.Struct("<QIIBBHI")      # ts_ns seq len kind page nruns rsvd
+
+PAGE_NAMES = ["state", "logs", "heat", "sched", "io", "lat", "prev", "cgroup", "oncpu", "stall"]
+PAGE_TILES = 0xFF  # frame drawn from a tiled layout
+
+# VGA colour index -> ANSI colour index (VGA is BGR, ANSI is RGB)
+VGA_TO_ANSI = [0, 4, 2, 6, 1, 5, 3, 7]
+
+
+class Frame:
+    def __init__(self, seq: int, ts_ns: int, page: int, cells: List[int]):
+        self.seq = seq
+        self.ts_ns = ts_ns
+        self.page = page
+        self.cells = cells
+
+
+def parse(data: bytes) -> Tuple[int, int, int, Iterator[Frame]]:
+    if len(data) < FILE_HDR.size:
+        raise ValueError("recording too short")
+    magic, version, cols, rows, nframes, _dropped = FILE_HDR.unpack_from(data, 0)
+    if magic != REC_MAGIC:
+        raise ValueError(f"bad magic {magic:#x}")
+    if version != REC_VERSION:
+        raise ValueError(f"unsupported version {version}")
+
+    def frames() -> Iterator[Frame]:
+        cells: List[int] = [0x0720] * (cols * rows)
+        off = FILE_HDR.size
+        for _ in range(nframes):
+            ts_ns, seq, length, kind, page, nruns, _rsvd = ENTRY_HDR.unpack_from(data, off)
+            p = off + ENTRY_HDR.size
+            if kind == REC_KEY:
+                cells = list(struct.unpack_from(f"<{cols * rows}H", data, p))
+            elif kind == REC_DELTA:
+                cells = list(cells)
+                for _ in range(nruns):
+                    start, count = struct.unpack_from("<HH", data, p)
+                    p += 4
+                    cells[start:start + count] = struct.unpack_from(f"<{count}H", data, p)
+                    p += 2 * count
+            else:
+                raise ValueError(f"bad entry kind {kind} at offset {off}")
+            yield Frame(seq, ts_ns, page, cells)
+            off += length
+
+    return cols, rows, nframes, frames()
+
+
+def sgr(attr: int) -> str:
+    fg = attr & 0x0F
+    bg = (attr >> 4) & 0x07
+    bold = "1;" if fg & 0x08 else "22;"
+    return f"\x1b[{bold}{30 + VGA_TO_ANSI[fg & 7]};{40 + VGA_TO_ANSI[bg]}m"
+
+
+def render(frame: Frame, cols: int, rows: int, color: bool) -> str:
+    out = []
+    for y in range(rows):
+        attr = None
+        line = []
+        for x in range(cols):
+            cell = frame.cells[y * cols + x]
+            ch = cell & 0xFF
+            a = cell >> 8
+            if color and a != attr:
+                line.append(sgr(a))
+                attr = a
+            line.append(chr(ch) if 0x20 <= ch < 0x7F else " ")
+        if color:
+            line.append("\x1b[0m")
+            out.append("".join(line))
+        else:
+            out.append("".join(line).rstrip())
+    return "\n".join(out)
+
+
+def status(frame: Frame) -> str:
+    if frame.page == PAGE_TILES:
+        page = "tiles"
+    else:
+        page = PAGE_NAMES[frame.page] if frame.page < len(PAGE_NAMES) else str(frame.page)
+    return f"frame {frame.seq}  t={frame.ts_ns / 1e9:.3f}s  page={page}"
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Replay a vgadash frame recording in the terminal")
+    ap.add_argument("path", nargs="?", type=Path, default=DEFAULT_PATH, help="Recording file")
+    ap.add_argument("--speed", type=float, default=1.0, help="Playback speed factor (0 = no delay)")
+    ap.add_argument("--frame", type=int, default=None, help="Print only this frame seq and exit")
+    ap.add_argument("--list", action="store_true", help="List frames instead of replaying")
+    ap.add_argument("--no-color", action="store_true", help="Plain text output")
+    args = ap.parse_args()
+
+    data = args.path.read_bytes()
+    cols, rows, nframes, frames = parse(data)
+    color = not args.no_color and sys.stdout.isatty()
+
+    if args.list:
+        for f in frames:
+            print(status(f))
+        print(f"{nframes} frames")
+        return
+
+    if args.frame is not None:
+        for f in frames:
+            if f.seq == args.frame:
+                print(status(f))
+                print(render(f, cols, rows, color))
+                return
+        raise SystemExit(f"frame {args.frame} not in recording")
+
+    prev_ts = None
+    try:
+        for f in frames:
+            if prev_ts is not None and args.speed > 0:
+                time.sleep(max(0.0, (f.ts_ns - prev_ts) / 1e9 / args.speed))
+            prev_ts = f.ts_ns
+            if color:
+                sys.stdout.write("\x1b[H\x1b[2J")
+            sys.stdout.write(status(f) + "\n" + render(f, cols, rows, color) + "\n")
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if color:
+            sys.stdout.write("\x1b[0m")
+
+
+if __name__ == "__main__":
+    main()